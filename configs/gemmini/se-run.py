@@ -26,6 +26,7 @@ system.gemmini_dev = GemminiDevA(
     ndp_data=("0x40001000", "0x80000000"),
     max_rsze=0x40,
     max_reqs=64,
+    zero_copy=True,
 )
 
 # Create L1 caches
@@ -59,6 +59,11 @@ board = X86Board(
     cache_hierarchy=cache_hierarchy,
 )
 
+# Completion interrupt on ISA IRQ 10, which no other south bridge device uses.
+# Load the driver with irq=10 to sleep on it instead of polling the status.
+ndp_device.int_pin = board.pc.south_bridge.pic2.inputs[2]
+ndp_device.int_pin = board.pc.south_bridge.io_apic.inputs[10]
+
 board.set_kernel_disk_workload(
     kernel=CustomResource("fs_files/binaries/x86-linux-kernel-5.4.0-105-generic"),
     kernel_args=[
@@ -30,6 +30,7 @@
 #ifndef __ARCH_RISCV_STATIC_INST_HH__
 #define __ARCH_RISCV_STATIC_INST_HH__
 
+#include <array>
 #include <string>
 
 #include "arch/riscv/pcstate.hh"
@@ -58,6 +59,21 @@ class RiscvStaticInst : public StaticInst
 
     bool alignmentOk(ExecContext* xc, Addr addr, Addr size) const;
 
+    /**
+     * Alignment required by a memory operand: its size, except for the
+     * register groups of the NDP instructions, which are made of 64-bit
+     * words and only need to be aligned to one of them.
+     */
+    template <typename T>
+    static constexpr Addr memAlignment(const T *) { return sizeof(T); }
+
+    template <typename T, std::size_t N>
+    static constexpr Addr
+    memAlignment(const std::array<T, N> *)
+    {
+        return sizeof(T);
+    }
+
   public:
     ExtMachInst machInst;
 
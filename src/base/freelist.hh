@@ -0,0 +1,155 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* @file
+ * Thread-local freelists of fixed size blocks, used to recycle the
+ * objects allocated on every memory access (packets, requests and their
+ * data) without going through malloc and free.
+ */
+
+#ifndef __BASE_FREELIST_HH__
+#define __BASE_FREELIST_HH__
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace gem5
+{
+
+/**
+ * Freelist of blocks of Size bytes. Every thread has its own list, so
+ * allocating and releasing blocks needs no synchronization. A block may
+ * be released by a different thread than the one that allocated it (it
+ * then moves to the list of the releasing thread), as all blocks come
+ * from the global operator new.
+ *
+ * The list is intrusive: a released block stores the pointer to the next
+ * one. It is made of plain thread-local variables without destructor, so
+ * it can still be used while static objects are being destroyed. Blocks
+ * above MaxFree are returned to the heap so that a burst of allocations
+ * does not pin memory for the rest of the simulation.
+ */
+template <std::size_t Size>
+class FreeList
+{
+  private:
+    struct Block
+    {
+        Block *next;
+    };
+
+    static thread_local Block *head;
+    static thread_local std::size_t numFree;
+
+  public:
+    static constexpr std::size_t BlockSize =
+        Size < sizeof(Block) ? sizeof(Block) : Size;
+
+    /** Number of free blocks kept by every thread. */
+    static constexpr std::size_t MaxFree = 4096;
+
+    static void *
+    allocate()
+    {
+        Block *block = head;
+        if (!block)
+            return ::operator new(BlockSize);
+
+        head = block->next;
+        --numFree;
+        return block;
+    }
+
+    static void
+    release(void *p)
+    {
+        if (numFree >= MaxFree) {
+            ::operator delete(p);
+            return;
+        }
+
+        Block *block = static_cast<Block *>(p);
+        block->next = head;
+        head = block;
+        ++numFree;
+    }
+
+    /** Number of free blocks in the list of the calling thread. */
+    static std::size_t size() { return numFree; }
+};
+
+template <std::size_t Size>
+thread_local typename FreeList<Size>::Block *FreeList<Size>::head = nullptr;
+
+template <std::size_t Size>
+thread_local std::size_t FreeList<Size>::numFree = 0;
+
+/**
+ * Allocator that takes single objects from the FreeList of their size,
+ * for instance to let std::allocate_shared recycle the combined control
+ * block and object of a shared_ptr.
+ */
+template <typename T>
+class PoolAllocator
+{
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "Pooled objects cannot be over-aligned");
+
+  public:
+    typedef T value_type;
+
+    PoolAllocator() = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) {}
+
+    T *
+    allocate(std::size_t n)
+    {
+        if (n == 1)
+            return static_cast<T *>(FreeList<sizeof(T)>::allocate());
+        return std::allocator<T>().allocate(n);
+    }
+
+    void
+    deallocate(T *p, std::size_t n)
+    {
+        if (n == 1)
+            FreeList<sizeof(T)>::release(p);
+        else
+            std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &) const { return true; }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &) const { return false; }
+};
+
+} // namespace gem5
+
+#endif // __BASE_FREELIST_HH__
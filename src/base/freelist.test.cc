@@ -0,0 +1,126 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "base/freelist.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+struct Object
+{
+    uint64_t words[5];
+};
+
+} // anonymous namespace
+
+/** Released blocks are handed out again, most recently released first. */
+TEST(FreeListTest, Recycle)
+{
+    typedef FreeList<48> List;
+
+    void *a = List::allocate();
+    void *b = List::allocate();
+    size_t free = List::size();
+
+    List::release(a);
+    List::release(b);
+    EXPECT_EQ(List::size(), free + 2);
+
+    EXPECT_EQ(List::allocate(), b);
+    EXPECT_EQ(List::allocate(), a);
+    EXPECT_EQ(List::size(), free);
+
+    List::release(a);
+    List::release(b);
+}
+
+/** No more than MaxFree blocks are kept, the rest go back to the heap. */
+TEST(FreeListTest, Cap)
+{
+    typedef FreeList<24> List;
+
+    std::vector<void *> blocks;
+    for (size_t i = 0; i < List::MaxFree + 16; i++)
+        blocks.push_back(List::allocate());
+    for (void *block : blocks)
+        List::release(block);
+
+    EXPECT_EQ(List::size(), List::MaxFree);
+}
+
+/** Every thread has its own list. */
+TEST(FreeListTest, ThreadLocal)
+{
+    typedef FreeList<40> List;
+
+    void *block = List::allocate();
+    List::release(block);
+    size_t free = List::size();
+
+    std::thread other([] {
+        EXPECT_EQ(List::size(), 0);
+        List::release(List::allocate());
+        EXPECT_EQ(List::size(), 1);
+    });
+    other.join();
+
+    EXPECT_EQ(List::size(), free);
+    EXPECT_EQ(List::allocate(), block);
+    List::release(block);
+}
+
+/** Shared objects built with PoolAllocator reuse their blocks. */
+TEST(FreeListTest, AllocateShared)
+{
+    auto first = std::allocate_shared<Object>(PoolAllocator<Object>());
+    first->words[0] = 1;
+    const void *block = first.get();
+    first.reset();
+
+    auto second = std::allocate_shared<Object>(PoolAllocator<Object>());
+    EXPECT_EQ(second.get(), block);
+
+    auto copy = second;
+    second.reset();
+    EXPECT_EQ(copy.get(), block);
+}
+
+/** Arrays bypass the freelist. */
+TEST(FreeListTest, AllocatorArray)
+{
+    PoolAllocator<Object> alloc;
+    std::vector<Object, PoolAllocator<Object>> objects(8, Object(), alloc);
+    objects.resize(64);
+    EXPECT_EQ(objects.size(), 64);
+}
@@ -2,7 +2,19 @@ from m5.params import *
 from m5.proxy import *
 from m5.objects.NDP import NDP
 
+class GemminiDataflow(Enum):
+	vals = ['WS', 'OS']
+
 class GemminiDevA(NDP):
 	type = 'GemminiDevA'
 	cxx_header = "gemmini_dev_a/gemmini_dev_a.hh"
-	cxx_class = 'gem5::GemminiDevA'
\ No newline at end of file
+	cxx_class = 'gem5::GemminiDevA'
+
+	simd_kernels = Param.Bool(True, "Use the cache-blocked, vectorized kernels for the functional model")
+	check_kernels = Param.Bool(False, "Check vectorized kernel results bit-by-bit against the scalar ones")
+
+	sa_rows = Param.Unsigned(16, "Number of rows of PEs in the systolic array")
+	sa_cols = Param.Unsigned(16, "Number of columns of PEs in the systolic array")
+	dataflow = Param.GemminiDataflow('WS', "Dataflow of the systolic array (weight or output stationary)")
+	spad_size = Param.MemorySize('256KiB', "Size of the scratchpad holding the operand tiles")
+	acc_size = Param.MemorySize('64KiB', "Size of the accumulator holding the partial results")
@@ -1,11 +1,42 @@
 #include "gemmini_dev_a/gemmini_dev_a.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "base/intmath.hh"
+
 namespace gem5
 {
     GemminiDevA::GemminiDevA(const GemminiDevAParams &params) :
-    NDP(params)
+    NDP(params),
+    layerEvent([this] { writeLayer(); }, name() + ".layerEvent"),
+    simdKernels(params.simd_kernels),
+    checkKernels(params.check_kernels),
+    saRows(params.sa_rows),
+    saCols(params.sa_cols),
+    dataflow(params.dataflow),
+    spadRows(params.spad_size / (params.sa_cols * sizeof(float))),
+    accRows(params.acc_size / (params.sa_cols * sizeof(float))),
+    computeEvent([this] { finishCompute(); }, name() + ".computeEvent")
     {
+        fatal_if(saRows == 0 || saCols == 0, "GemminiDevA systolic array cannot be empty.\n");
+        fatal_if(
+            spadRows < 2 * saRows || accRows < saRows,
+            "GemminiDevA scratchpad or accumulator cannot hold a tile of the systolic array.\n"
+        );
+
+        if (simdKernels)
+            DPRINTF(GemminiDevA, "Using %s kernels\n", gemmini_simd::isa());
 
+        // Statistics of every opcode, followed by the layer operations
+        for (const char *op : {"conv2d", "conv2dGemm", "conv3d", "conv3dGemm",
+                               "maxpool", "maxpoolGemm", "relu", "mm", "mmGemm",
+                               "layerConv2d", "layerMatmul", "layerMaxpool",
+                               "layerRelu"})
+            addOp(op);
     }
 
     uint64_t 
@@ -58,6 +89,7 @@ namespace gem5
                 pi_status
             );
             pi_status = 0;
+            jobStart = curTick();
 
             // Allocate memory for operands and result
             switch (pi_opcode)
@@ -106,28 +138,106 @@ namespace gem5
                 k = (float *) malloc(k_size);
 
             // Start finite state machine
+            planTiles();
             process_fsm();
             break;
+        case 8: pi_addr_desc = data; break;
+        case 9:
+            DPRINTF(
+                GemminiDevAPI,
+                "GemminiDevA started processing layer descriptor at %p\n",
+                pi_addr_desc
+            );
+            pi_status = 0;
+            jobStart = curTick();
+            layerJob = true;
+            layerState = layer_fetch_desc;
+            layerPending = 1;
+
+            accessMemory(
+                Addr(pi_addr_desc),
+                sizeof(LayerDesc),
+                false,
+                (uint8_t *) &layer
+            );
+            break;
         default:
             panic("GemminiDevA does not have writable r[%lu] register!\n", ridx);
         }
     }
 
+    bool
+    GemminiDevA::peekPI(uint64_t ridx, uint64_t &data)
+    {
+        switch (ridx)
+        {
+        case 0: data = pi_addr_m; return true;
+        case 1: data = pi_addr_k; return true;
+        case 2: data = pi_addr_o; return true;
+        case 3: data = pi_size_m; return true;
+        case 4: data = pi_size_k; return true;
+        case 5: data = pi_opcode; return true;
+        case 7: data = pi_status; return true;
+        case 8: data = pi_addr_desc; return true;
+        default: return false;
+        }
+    }
+
+    bool
+    GemminiDevA::pokePI(uint64_t ridx, uint64_t data)
+    {
+        switch (ridx)
+        {
+        case 0: pi_addr_m = data; return true;
+        case 1: pi_addr_k = data; return true;
+        case 2: pi_addr_o = data; return true;
+        case 3: pi_size_m = data; return true;
+        case 4: pi_size_k = data; return true;
+        case 5: pi_opcode = data; return true;
+        case 8: pi_addr_desc = data; return true;
+        default: return false;
+        }
+    }
+
     void 
     GemminiDevA::recvData(Addr addr, uint8_t *data, size_t size)
     {
         DPRINTF(GemminiDevAMem, "GemminiDevA received %u bytes from %p\n", size, addr);
 
-        if (data)
+        if (layerJob)
+        {
+            layerRecvData(addr, data, size);
+        }
+        else if (data)
         {
-            has_operands++;
+            if (k_size > 0 && data == (uint8_t *) k)
+            {
+                kLoaded = true;
+
+                // Once per job rather than once per tile
+                if (simdKernels && pi_opcode == op_mm_gemm)
+                    transposeK();
+            }
+            else
+            {
+                for (uint64_t t = loadedTiles; t < fetchedTiles; t++)
+                {
+                    if (tileFetch[t] == data)
+                        tileLoaded[t] = true;
+                }
+
+                // A tile may reuse rows of m fetched for earlier tiles
+                while (loadedTiles < fetchedTiles && tileLoaded[loadedTiles])
+                    loadedTiles++;
+            }
 
             process_fsm();
         }
-        else
+        else if (++writtenTiles == numTiles)
         {
             pi_status = 1;
-            has_operands = 0;
+            recordOp(pi_opcode, jobStart);
+            notifyCompletion();
 
             free(m);
             free(o);
@@ -137,74 +247,676 @@ namespace gem5
     }
 
     void
-    GemminiDevA::process_fsm()
+    GemminiDevA::planTiles()
     {
-        // Retrieve m from memory
-        if (has_operands == 0)
+        uint64_t m_elems = m_size / sizeof(float);
+
+        switch (pi_opcode)
+        {
+        // One output row (2D) or plane (3D) per tile row
+        case op_conv2d:
+        case op_conv2d_gemm:
+        case op_relu:
+        case op_mm:
+        case op_mm_gemm:      oRows = pi_size_m;
+                              oRowElems = pi_size_m;
+                              break;
+        case op_conv3d:
+        case op_conv3d_gemm:  oRows = pi_size_m;
+                              oRowElems = pi_size_m * pi_size_m;
+                              break;
+        case op_maxpool:
+        case op_maxpool_gemm: oRows =
+                              oRowElems = pi_size_m / pi_size_k;
+                              break;
+        default:              panic("An invalid opcode was issued!\n");
+        }
+
+        // Half of the scratchpad holds the operands of a tile while the
+        // other half is refilled, k is kept resident. The outputs of a tile
+        // must fit in the accumulator.
+        uint64_t row_m_elems = std::max<uint64_t>(1, divCeil(m_elems, std::max<uint64_t>(1, oRows))),
+                 spad_tile_rows = spadRows * saCols / 2 / row_m_elems,
+                 acc_tile_rows = accRows * saCols / std::max<uint64_t>(1, oRowElems);
+
+        tileRows = std::max<uint64_t>(1, std::min(spad_tile_rows, acc_tile_rows));
+        numTiles = divCeil(oRows, tileRows);
+        jobCycles = computeCycles();
+
+        DPRINTF(
+            GemminiDevA,
+            "Processing %lu rows in %lu tiles of %lu rows\n",
+            oRows,
+            numTiles,
+            tileRows
+        );
+
+        mFetched = 0;
+        tileFetch.assign(numTiles, nullptr);
+        tileLoaded.assign(numTiles, false);
+        fetchedTiles = loadedTiles = computedTiles = writtenTiles = 0;
+        kLoaded = false;
+
+        // Nothing to compute
+        if (numTiles == 0)
+        {
+            pi_status = 1;
+            recordOp(pi_opcode, jobStart);
+            notifyCompletion();
+
+            free(m);
+            free(o);
+            if (k_size > 0)
+                free(k);
+        }
+        else if (k_size > 0)
         {
             DPRINTF(
                 GemminiDevA,
-                "Retrieving m from memory\n"
+                "Retrieving k from memory\n"
             );
 
             accessMemory(
-                Addr(pi_addr_m),
-                m_size,
+                Addr(pi_addr_k),
+                k_size,
                 false,
-                (uint8_t *) m
+                (uint8_t *) k
             );
         }
-        // Retrieve k from memory
-        else if(has_operands == 1 && k_size > 0)
+    }
+
+    void
+    GemminiDevA::tileInput(uint64_t row_lo, uint64_t row_hi, uint64_t &m_lo, uint64_t &m_hi)
+    {
+        // Elements of m read to compute output rows [row_lo, row_hi)
+        uint64_t half = pi_size_k / 2,
+                 k2 = pi_size_k * pi_size_k;
+
+        switch (pi_opcode)
+        {
+        // Convolutions also read the rows (planes) around the tile
+        case op_conv2d:
+        case op_conv3d:       m_lo = (row_lo > half ? row_lo - half : 0) * oRowElems;
+                              m_hi = std::min(pi_size_m, row_hi + pi_size_k - 1 - half) * oRowElems;
+                              break;
+        case op_conv2d_gemm:  m_lo = row_lo * oRowElems * k2;
+                              m_hi = row_hi * oRowElems * k2;
+                              break;
+        case op_conv3d_gemm:  m_lo = row_lo * oRowElems * k2 * pi_size_k;
+                              m_hi = row_hi * oRowElems * k2 * pi_size_k;
+                              break;
+        case op_maxpool:
+        case op_maxpool_gemm: m_lo = row_lo * pi_size_m * pi_size_k;
+                              m_hi = row_hi * pi_size_m * pi_size_k;
+                              break;
+        default:              m_lo = row_lo * oRowElems;
+                              m_hi = row_hi * oRowElems;
+                              break;
+        }
+    }
+
+    void
+    GemminiDevA::fetchTiles()
+    {
+        // Double buffering: fetch at most one tile ahead of the one computing
+        while (fetchedTiles < numTiles && fetchedTiles < computedTiles + 2)
         {
+            uint64_t t = fetchedTiles++,
+                     row_lo = t * tileRows,
+                     row_hi = std::min(oRows, row_lo + tileRows),
+                     m_lo, m_hi;
+
+            tileInput(row_lo, row_hi, m_lo, m_hi);
+
+            // Rows shared with the previous tile were already requested
+            if (m_hi <= mFetched)
+            {
+                tileLoaded[t] = true;
+                continue;
+            }
+
+            m_lo = std::max(m_lo, mFetched);
+            mFetched = m_hi;
+            tileFetch[t] = (uint8_t *) (m + m_lo);
+
             DPRINTF(
                 GemminiDevA,
-                "Retrieving k from memory\n"
+                "Retrieving tile %lu of m from memory\n",
+                t
             );
 
             accessMemory(
-                Addr(pi_addr_k),
-                k_size,
+                Addr(pi_addr_m + m_lo * sizeof(float)),
+                (m_hi - m_lo) * sizeof(float),
                 false,
-                (uint8_t *) k
+                tileFetch[t]
             );
         }
+
+        while (loadedTiles < fetchedTiles && tileLoaded[loadedTiles])
+            loadedTiles++;
+    }
+
+    void
+    GemminiDevA::tryCompute()
+    {
+        if (computeEvent.scheduled() || computedTiles >= loadedTiles ||
+            (k_size > 0 && !kLoaded))
+            return;
+
+        uint64_t row_lo = computedTiles * tileRows,
+                 row_hi = std::min(oRows, row_lo + tileRows);
+
+        DPRINTF(
+            GemminiDevA,
+            "Processing tile %lu...\n",
+            computedTiles
+        );
+
+        compute(o, simdKernels, row_lo, row_hi);
+
+        if (simdKernels && checkKernels && computedTiles + 1 == numTiles)
+        {
+            float *ref = (float *) malloc(o_size);
+
+            compute(ref, false, 0, oRows);
+            panic_if(
+                memcmp(ref, o, o_size) != 0,
+                "Vectorized kernel for opcode %lu differs from the scalar one!\n",
+                pi_opcode
+            );
+
+            free(ref);
+        }
+
+        // Each tile takes its share of the cycles of the whole operation
+        Cycles cycles(divCeil(jobCycles * (row_hi - row_lo), oRows));
+        recordCompute(cycles);
+        schedule(computeEvent, clockEdge(cycles));
+    }
+
+    void
+    GemminiDevA::finishCompute()
+    {
+        uint64_t row_lo = computedTiles * tileRows,
+                 row_hi = std::min(oRows, row_lo + tileRows);
+
+        computedTiles++;
+
+        // Results of the tile are written back while the next one computes
+        accessMemory(
+            Addr(pi_addr_o + row_lo * oRowElems * sizeof(float)),
+            (row_hi - row_lo) * oRowElems * sizeof(float),
+            true,
+            (uint8_t *) (o + row_lo * oRowElems)
+        );
+
+        process_fsm();
+    }
+
+    void
+    GemminiDevA::process_fsm()
+    {
+        fetchTiles();
+        tryCompute();
+    }
+
+    Cycles
+    GemminiDevA::systolicCycles(uint64_t i_size, uint64_t j_size, uint64_t k_size)
+    {
+        // Cycles of an (i_size x k_size) * (k_size x j_size) matrix product,
+        // none for an empty reduction (e.g., a size or channel count of 0)
+        if (k_size == 0)
+            return Cycles(0);
+
+        uint64_t tiles_j = divCeil(j_size, saCols),
+                 fill_drain = saRows + saCols - 1;
+
+        if (dataflow == enums::WS)
+        {
+            // Each saRows x saCols tile of weights is preloaded and the rows
+            // of the input stream through it, accumulating as many output
+            // rows as the accumulator holds
+            uint64_t tiles_k = divCeil(k_size, saRows),
+                     tiles_i = divCeil(i_size, accRows);
+
+            return Cycles(tiles_j * tiles_k *
+                (i_size + tiles_i * (saRows + fill_drain)));
+        }
         else
         {
-            DPRINTF(
-                GemminiDevA,
-                "Processing operation...\n"
+            // Each saRows x saCols tile of outputs stays in the array while
+            // both operands stream through it, as much of the reduction at
+            // a time as fits in half the scratchpad, and is then shifted out
+            uint64_t tiles_i = divCeil(i_size, saRows),
+                     tile_k = std::min(k_size, spadRows / 2),
+                     tiles_k = divCeil(k_size, tile_k);
+
+            return Cycles(tiles_i * tiles_j *
+                (k_size + tiles_k * fill_drain + saRows));
+        }
+    }
+
+    Cycles
+    GemminiDevA::computeCycles()
+    {
+        uint64_t m2 = pi_size_m * pi_size_m,
+                 k2 = pi_size_k * pi_size_k;
+
+        switch (pi_opcode)
+        {
+        // Convolutions are lowered to a single-channel GEMM (im2col)
+        case op_conv2d:
+        case op_conv2d_gemm:  return systolicCycles(m2, 1, k2);
+        case op_conv3d:
+        case op_conv3d_gemm:  return systolicCycles(m2 * pi_size_m, 1, k2 * pi_size_k);
+        // Pooling and activations are applied by the output stage, one
+        // row of saCols elements per cycle
+        case op_maxpool:
+        case op_maxpool_gemm:
+        case op_relu:         return Cycles(divCeil(m2, saCols));
+        case op_mm:
+        case op_mm_gemm:      return systolicCycles(pi_size_m, pi_size_m, pi_size_m);
+        default:              panic("An invalid opcode was issued!\n");
+        }
+    }
+
+    void
+    GemminiDevA::compute(float *o, bool simd, uint64_t row_lo, uint64_t row_hi)
+    {
+        uint64_t m2 = pi_size_m * pi_size_m,
+                 k2 = pi_size_k * pi_size_k;
+
+        switch (pi_opcode)
+        {
+        case op_conv2d:       simd ? fastConv_2D(m, k, o, pi_size_m, pi_size_k, row_lo, row_hi)
+                                   : baseConv_2D(m, k, o, pi_size_m, pi_size_k, row_lo, row_hi); break;
+        case op_conv2d_gemm:  baseConvGemm(m, k, o, m2, k2, row_lo * oRowElems, row_hi * oRowElems); break;
+        case op_conv3d:       simd ? fastConv_3D(m, k, o, pi_size_m, pi_size_k, row_lo, row_hi)
+                                   : baseConv_3D(m, k, o, pi_size_m, pi_size_k, row_lo, row_hi); break;
+        case op_conv3d_gemm:  baseConvGemm(m, k, o, m2 * pi_size_m, k2 * pi_size_k, row_lo * oRowElems, row_hi * oRowElems); break;
+        case op_maxpool:      simd ? fastMaxPool(m, o, pi_size_m, pi_size_k, row_lo, row_hi)
+                                   : baseMaxPool(m, o, pi_size_m, pi_size_k, row_lo, row_hi); break;
+        case op_maxpool_gemm: baseMaxPoolGemm(m, o, pi_size_m, pi_size_k, row_lo, row_hi); break;
+        case op_relu:         baseRelu(m, o, pi_size_m, row_lo, row_hi); break;
+        case op_mm:           simd ? fastMM(m, k, o, pi_size_m, row_lo, row_hi)
+                                   : baseMM(m, k, o, pi_size_m, row_lo, row_hi); break;
+        case op_mm_gemm:      simd ? fastMMGemm(m, kT.data(), o, pi_size_m, row_lo, row_hi)
+                                   : baseMMGemm(m, k, o, pi_size_m, row_lo, row_hi); break;
+        default: panic("Not implemented yet!\n");
+        }
+    }
+
+    void
+    GemminiDevA::startLayer()
+    {
+        static_assert(sizeof(LayerDesc) == 35 * sizeof(uint64_t),
+                      "Layer descriptor must not be padded");
+
+        uint64_t *in = layer.in.dims,
+                 *wt = layer.wt.dims,
+                 *out = layer.out.dims;
+
+        DPRINTF(
+            GemminiDevA,
+            "Layer op %lu type %lu: in [%lu %lu %lu %lu] wt [%lu %lu %lu %lu] "
+            "out [%lu %lu %lu %lu]\n",
+            layer.op, layer.dtype,
+            in[0], in[1], in[2], in[3],
+            wt[0], wt[1], wt[2], wt[3],
+            out[0], out[1], out[2], out[3]
+        );
+
+        panic_if(layer.dtype > type_int8, "Invalid layer data type %lu!\n", layer.dtype);
+
+        // Output rows (columns) of a convolution or pooling window
+        auto windows = [](uint64_t size, uint64_t pad, uint64_t window, uint64_t stride)
+        {
+            return size + 2 * pad < window ? 0 :
+                (size + 2 * pad - window) / stride + 1;
+        };
+
+        switch (layer.op)
+        {
+        case layer_conv2d:
+            panic_if(
+                layer.stride_h == 0 || layer.stride_w == 0 ||
+                wt[1] != in[1] || out[0] != in[0] || out[1] != wt[0] ||
+                out[2] != windows(in[2], layer.pad_h, wt[2], layer.stride_h) ||
+                out[3] != windows(in[3], layer.pad_w, wt[3], layer.stride_w),
+                "Invalid convolution layer descriptor!\n"
+            );
+            break;
+        case layer_matmul:
+            panic_if(
+                (wt[0] != 1 && wt[0] != in[0]) || (wt[1] != 1 && wt[1] != in[1]) ||
+                wt[2] != in[3] || out[0] != in[0] || out[1] != in[1] ||
+                out[2] != in[2] || out[3] != wt[3],
+                "Invalid matmul layer descriptor!\n"
+            );
+            break;
+        case layer_maxpool:
+            panic_if(
+                layer.stride_h == 0 || layer.stride_w == 0 ||
+                layer.window_h == 0 || layer.window_w == 0 ||
+                out[0] != in[0] || out[1] != in[1] ||
+                out[2] != windows(in[2], layer.pad_h, layer.window_h, layer.stride_h) ||
+                out[3] != windows(in[3], layer.pad_w, layer.window_w, layer.stride_w),
+                "Invalid max pooling layer descriptor!\n"
+            );
+            break;
+        case layer_relu:
+            panic_if(
+                !std::equal(in, in + 4, out),
+                "Invalid ReLU layer descriptor!\n"
             );
+            break;
+        default:
+            panic("An invalid layer opcode was issued!\n");
+        }
 
-            switch (pi_opcode)
+        layerState = layer_fetch_data;
+        layerPending = 0;
+
+        accessTensor(tensor_in, false);
+        if (layer.op == layer_conv2d || layer.op == layer_matmul)
+            accessTensor(tensor_wt, false);
+
+        // Empty tensors
+        if (layerPending == 0)
+            computeLayer();
+    }
+
+    void
+    GemminiDevA::accessTensor(TensorId id, bool write)
+    {
+        TensorDesc &t = id == tensor_in ? layer.in :
+                        id == tensor_wt ? layer.wt : layer.out;
+        uint64_t *dims = t.dims, *strides = t.strides;
+        size_t elem = layerElemSize(),
+               span = dims[3] ? ((dims[3] - 1) * strides[3] + 1) * elem : 0;
+
+        if (!write)
+            layerRows[id].assign(dims[0] * dims[1] * dims[2] * span, 0);
+
+        if (span == 0)
+            return;
+
+        // One burst per row of W elements, gaps between strided elements
+        // are read but never written
+        uint8_t *rows = layerRows[id].data();
+
+        for (uint64_t n = 0; n < dims[0]; n++)
+            for (uint64_t c = 0; c < dims[1]; c++)
+                for (uint64_t h = 0; h < dims[2]; h++, rows += span)
+                {
+                    Addr row_addr = t.addr +
+                        (n * strides[0] + c * strides[1] + h * strides[2]) * elem;
+
+                    if (!write || strides[3] == 1)
+                    {
+                        accessMemory(row_addr, span, write, rows);
+                        layerPending++;
+                    }
+                    else
+                    {
+                        for (uint64_t w = 0; w < dims[3]; w++)
+                        {
+                            uint64_t offset = w * strides[3] * elem;
+
+                            accessMemory(row_addr + offset, elem, true, rows + offset);
+                            layerPending++;
+                        }
+                    }
+                }
+    }
+
+    void
+    GemminiDevA::unpackTensor(TensorId id)
+    {
+        TensorDesc &t = id == tensor_in ? layer.in : layer.wt;
+        uint64_t rows = t.dims[0] * t.dims[1] * t.dims[2], cols = t.dims[3];
+        size_t elem = layerElemSize(),
+               span = cols ? ((cols - 1) * t.strides[3] + 1) * elem : 0;
+
+        layerData[id].resize(rows * cols);
+
+        for (uint64_t r = 0; r < rows; r++)
+            for (uint64_t w = 0; w < cols; w++)
             {
-            case op_conv2d:       baseConv_2D(m, k, o, pi_size_m, pi_size_k); break;
-            case op_conv2d_gemm:  baseConvGemm(m, k, o, pi_size_m * pi_size_m, pi_size_k * pi_size_k); break;
-            case op_conv3d:       baseConv_3D(m, k, o, pi_size_m, pi_size_k); break;
-            case op_conv3d_gemm:  baseConvGemm(m, k, o, pi_size_m * pi_size_m * pi_size_m, pi_size_k * pi_size_k * pi_size_k); break;
-            case op_maxpool:      baseMaxPool(m, o, pi_size_m, pi_size_k); break;
-            case op_maxpool_gemm: baseMaxPoolGemm(m, o, pi_size_m, pi_size_k); break;
-            case op_relu:         baseRelu(m, o, pi_size_m); break;
-            case op_mm:           baseMM(m, k, o, pi_size_m); break;
-            case op_mm_gemm:      baseMMGemm(m, k, o, pi_size_m); break;
-            default: panic("Not implemented yet!\n");
+                uint8_t *raw = layerRows[id].data() + r * span + w * t.strides[3] * elem;
+                float &value = layerData[id][r * cols + w];
+
+                switch (layer.dtype)
+                {
+                case type_fp32:  memcpy(&value, raw, sizeof(float)); break;
+                case type_int32: value = *(int32_t *) raw; break;
+                case type_int8:  value = *(int8_t *) raw; break;
+                }
             }
 
-            accessMemory(
-                Addr(pi_addr_o),
-                o_size,
-                true,
-                (uint8_t *) o
-            );
+        layerRows[id].clear();
+    }
+
+    void
+    GemminiDevA::packTensor(TensorId id)
+    {
+        TensorDesc &t = layer.out;
+        uint64_t rows = t.dims[0] * t.dims[1] * t.dims[2], cols = t.dims[3];
+        size_t elem = layerElemSize(),
+               span = cols ? ((cols - 1) * t.strides[3] + 1) * elem : 0;
+
+        layerRows[id].assign(rows * span, 0);
+
+        for (uint64_t r = 0; r < rows; r++)
+            for (uint64_t w = 0; w < cols; w++)
+            {
+                uint8_t *raw = layerRows[id].data() + r * span + w * t.strides[3] * elem;
+                float value = layerData[id][r * cols + w];
+
+                // Integer results saturate like the accumulator output
+                switch (layer.dtype)
+                {
+                case type_fp32:
+                    memcpy(raw, &value, sizeof(float));
+                    break;
+                case type_int32:
+                    *(int32_t *) raw = std::isnan(value) ? 0 : (int32_t)
+                        std::lrint(std::clamp<double>(value, INT32_MIN, INT32_MAX));
+                    break;
+                case type_int8:
+                    *(int8_t *) raw = std::isnan(value) ? 0 : (int8_t)
+                        std::lrint(std::clamp<float>(value, INT8_MIN, INT8_MAX));
+                    break;
+                }
+            }
+    }
+
+    void
+    GemminiDevA::computeLayer()
+    {
+        uint64_t *in = layer.in.dims,
+                 *wt = layer.wt.dims,
+                 *out = layer.out.dims;
+
+        unpackTensor(tensor_in);
+        if (layer.op == layer_conv2d || layer.op == layer_matmul)
+            unpackTensor(tensor_wt);
+
+        const float *x = layerData[tensor_in].data(),
+                    *w = layerData[tensor_wt].data();
+        std::vector<float> &y_data = layerData[tensor_out];
+
+        y_data.assign(out[0] * out[1] * out[2] * out[3], 0.0f);
+        float *y = y_data.data();
+
+        switch (layer.op)
+        {
+        case layer_conv2d:
+        {
+            int64_t H = in[2], W = in[3], R = wt[2], S = wt[3],
+                    P = out[2], Q = out[3],
+                    sh = layer.stride_h, sw = layer.stride_w,
+                    ph = layer.pad_h, pw = layer.pad_w;
+
+            for (uint64_t n = 0; n < in[0]; n++)
+                for (uint64_t kk = 0; kk < wt[0]; kk++)
+                    for (uint64_t c = 0; c < in[1]; c++)
+                        for (int64_t r = 0; r < R; r++)
+                            for (int64_t s = 0; s < S; s++)
+                            {
+                                float wv = w[((kk * in[1] + c) * R + r) * S + s];
+
+                                for (int64_t p = 0; p < P; p++)
+                                {
+                                    int64_t h = p * sh - ph + r;
+
+                                    if (h < 0 || h >= H)
+                                        continue;
+
+                                    float *y_row = y + ((n * out[1] + kk) * P + p) * Q;
+                                    const float *x_row = x + ((n * in[1] + c) * H + h) * W;
+
+                                    // Outputs q whose input column q * sw - pw + s is inside x
+                                    int64_t q_lo = std::max<int64_t>(0, divCeil(std::max<int64_t>(0, pw - s), sw)),
+                                            q_hi = std::min<int64_t>(Q, W + pw - s <= 0 ? 0 : divCeil(W + pw - s, sw));
+
+                                    if (sw == 1)
+                                    {
+                                        if (q_lo < q_hi)
+                                            gemmini_simd::axpy(y_row + q_lo, x_row + q_lo - pw + s, wv, q_hi - q_lo);
+                                    }
+                                    else
+                                    {
+                                        for (int64_t q = q_lo; q < q_hi; q++)
+                                            y_row[q] += x_row[q * sw - pw + s] * wv;
+                                    }
+                                }
+                            }
+            break;
+        }
+        case layer_matmul:
+        {
+            uint64_t M = in[2], K = in[3], N = wt[3];
+
+            for (uint64_t b0 = 0; b0 < in[0]; b0++)
+                for (uint64_t b1 = 0; b1 < in[1]; b1++)
+                {
+                    const float *a = x + (b0 * in[1] + b1) * M * K,
+                                *b = w + ((wt[0] == 1 ? 0 : b0) * wt[1] + (wt[1] == 1 ? 0 : b1)) * K * N;
+                    float *c = y + (b0 * in[1] + b1) * M * N;
+
+                    for (uint64_t i = 0; i < M; i++)
+                        for (uint64_t kk = 0; kk < K; kk++)
+                            gemmini_simd::axpy(c + i * N, b + kk * N, a[i * K + kk], N);
+                }
+            break;
+        }
+        case layer_maxpool:
+        {
+            int64_t H = in[2], W = in[3], P = out[2], Q = out[3];
+
+            for (uint64_t plane = 0; plane < in[0] * in[1]; plane++)
+                for (int64_t p = 0; p < P; p++)
+                    for (int64_t q = 0; q < Q; q++)
+                    {
+                        float max = -std::numeric_limits<float>::infinity();
+
+                        for (int64_t r = 0; r < layer.window_h; r++)
+                            for (int64_t s = 0; s < layer.window_w; s++)
+                            {
+                                int64_t h = p * layer.stride_h - layer.pad_h + r,
+                                        v = q * layer.stride_w - layer.pad_w + s;
+
+                                // Padding never wins
+                                if (h >= 0 && h < H && v >= 0 && v < W &&
+                                    x[(plane * H + h) * W + v] > max)
+                                    max = x[(plane * H + h) * W + v];
+                            }
+
+                        y[(plane * P + p) * Q + q] = max;
+                    }
+            break;
+        }
+        case layer_relu:
+            for (uint64_t i = 0; i < y_data.size(); i++)
+                y[i] = (x[i] < 0) ? 0 : x[i];
+            break;
+        }
+
+        layerData[tensor_in].clear();
+        layerData[tensor_wt].clear();
+
+        Cycles cycles = layerCycles();
+
+        DPRINTF(GemminiDevA, "Layer takes %lu cycles\n", cycles);
+        recordCompute(cycles);
+
+        schedule(layerEvent, clockEdge(cycles));
+    }
+
+    Cycles
+    GemminiDevA::layerCycles()
+    {
+        uint64_t *in = layer.in.dims,
+                 *wt = layer.wt.dims,
+                 *out = layer.out.dims;
+
+        switch (layer.op)
+        {
+        // Convolutions are lowered to a GEMM (im2col) over all channels
+        case layer_conv2d:  return systolicCycles(out[0] * out[2] * out[3], wt[0], in[1] * wt[2] * wt[3]);
+        case layer_matmul:  return Cycles(in[0] * in[1] * systolicCycles(in[2], wt[3], in[3]));
+        default:            return Cycles(divCeil(out[0] * out[1] * out[2] * out[3], saCols));
+        }
+    }
+
+    void
+    GemminiDevA::writeLayer()
+    {
+        packTensor(tensor_out);
+        layerData[tensor_out].clear();
+
+        layerState = layer_write;
+        layerPending = 0;
+        accessTensor(tensor_out, true);
+
+        // Empty output
+        if (layerPending == 0)
+            layerRecvData(0, NULL, 0);
+    }
+
+    void
+    GemminiDevA::layerRecvData(Addr addr, uint8_t *data, size_t size)
+    {
+        if (layerPending > 0 && --layerPending > 0)
+            return;
+
+        switch (layerState)
+        {
+        case layer_fetch_desc:
+            startLayer();
+            break;
+        case layer_fetch_data:
+            computeLayer();
+            break;
+        case layer_write:
+            DPRINTF(GemminiDevA, "Layer completed\n");
+            layerRows[tensor_out].clear();
+            layerJob = false;
+            pi_status = 1;
+            recordOp(num_ops + layer.op, jobStart);
+            notifyCompletion();
+            break;
         }
     }
 
     /* ==================== BEGIN SPECIFIC METHODS ==================== */
 
     void
-    GemminiDevA::baseConv_2D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size)
+    GemminiDevA::baseConv_2D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi)
     {
-        for (int i = 0; i < m_size; i++)
+        for (int i = row_lo; i < row_hi; i++)
             for (int j = 0; j < m_size; j++)
             {
                 o[i * m_size + j] = 0;
@@ -228,9 +940,9 @@ namespace gem5
     }
 
     void
-    GemminiDevA::baseConv_3D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size)
+    GemminiDevA::baseConv_3D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi)
     {
-        for (int i = 0; i < m_size; i++)
+        for (int i = row_lo; i < row_hi; i++)
             for (int j = 0; j < m_size; j++)
                 for (int w = 0; w < m_size; w++)
                 {
@@ -259,9 +971,9 @@ namespace gem5
     }
 
     void
-    GemminiDevA::baseConvGemm(float *a, float *k, float *o, unsigned int o_size, unsigned int k_size)
+    GemminiDevA::baseConvGemm(float *a, float *k, float *o, unsigned int o_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi)
     {
-        for (int i = 0; i < o_size; i++)
+        for (int i = row_lo; i < row_hi; i++)
         {
             o[i] = 0;
 
@@ -271,11 +983,11 @@ namespace gem5
     }
 
     void
-    GemminiDevA::baseMaxPool(float *m, float *o, unsigned int m_size, unsigned int k_size)
+    GemminiDevA::baseMaxPool(float *m, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi)
     {
         assert(m_size % k_size == 0);
 
-        for (int i = 0; i < m_size / k_size; i++)
+        for (int i = row_lo; i < row_hi; i++)
             for (int j = 0; j < m_size / k_size; j++)
             {
                 o[i * m_size / k_size + j] = m[i * k_size * m_size + j * k_size];
@@ -292,9 +1004,9 @@ namespace gem5
     }
 
     void
-    GemminiDevA::baseMaxPoolGemm(float *a, float *o, unsigned int m_size, unsigned int k_size)
+    GemminiDevA::baseMaxPoolGemm(float *a, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi)
     {
-        for (int i = 0; i < m_size / k_size; i++)
+        for (int i = row_lo; i < row_hi; i++)
             for (int j = 0; j < m_size / k_size; j++)
             {
                 unsigned int offset = (i * m_size / k_size + j) * k_size * k_size;
@@ -309,22 +1021,22 @@ namespace gem5
                             max = a[idx];
                     }
 
-                o[i * m_size / 2 + j] = max;
+                o[i * m_size / k_size + j] = max;
             }
     }
 
     void
-    GemminiDevA::baseRelu(float *m, float *o, unsigned int m_size)
+    GemminiDevA::baseRelu(float *m, float *o, unsigned int m_size, unsigned int row_lo, unsigned int row_hi)
     {
-        for (int i = 0; i < m_size; i++)
+        for (int i = row_lo; i < row_hi; i++)
             for (int j = 0; j < m_size; j++)
                 o[i * m_size + j] = (m[i * m_size + j] < 0) ? 0 : m[i * m_size + j];
     }
 
     void
-    GemminiDevA::baseMM(float *a, float *b, float *c, unsigned int m_size)
+    GemminiDevA::baseMM(float *a, float *b, float *c, unsigned int m_size, unsigned int row_lo, unsigned int row_hi)
     {
-        for (int i = 0; i < m_size; i++)
+        for (int i = row_lo; i < row_hi; i++)
             for (int j = 0; j < m_size; j++)
             {
                 c[i * m_size + j] = 0;
@@ -335,9 +1047,9 @@ namespace gem5
     }
 
     void
-    GemminiDevA::baseMMGemm(float *a, float *b, float *c, unsigned int m_size)
+    GemminiDevA::baseMMGemm(float *a, float *b, float *c, unsigned int m_size, unsigned int row_lo, unsigned int row_hi)
     {
-        for (int i = 0; i < m_size; i++)
+        for (int i = row_lo; i < row_hi; i++)
             for (int j = 0; j < m_size; j++)
             {
                 c[i * m_size + j] = 0;
@@ -347,6 +1059,159 @@ namespace gem5
             }
     }
 
+    /*
+     * The fast kernels below reorder the loops of the base kernels so that
+     * the innermost loop runs over contiguous outputs and is vectorized by
+     * gemmini_simd::axpy. Every output still accumulates its terms in the
+     * same order as in the base kernel, so results are bit-exact.
+     */
+
+    // Tile sizes of fastMM, chosen to keep a tile of b in the L2 cache
+    static const unsigned int mmTileRows = 32;
+    static const unsigned int mmTileCols = 256;
+    static const unsigned int mmTileDepth = 128;
+
+    void
+    GemminiDevA::fastConv_2D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi)
+    {
+        int size = m_size, half = k_size / 2;
+
+        std::fill(o + row_lo * m_size, o + row_hi * m_size, 0.0f);
+
+        for (int i = row_lo; i < row_hi; i++)
+            for (int w = 0; w < k_size; w++)
+            {
+                int m_i = i + w - half;
+
+                if (m_i < 0 || m_i >= size)
+                    continue;
+
+                for (int x = 0; x < k_size; x++)
+                {
+                    // Outputs j whose input column j + dx is inside m
+                    int dx = x - half,
+                        j_lo = std::max(0, -dx),
+                        j_hi = std::min(size, size - dx);
+
+                    if (j_lo < j_hi)
+                        gemmini_simd::axpy(
+                            o + i * size + j_lo,
+                            m + m_i * size + j_lo + dx,
+                            k[w * k_size + x],
+                            j_hi - j_lo
+                        );
+                }
+            }
+    }
+
+    void
+    GemminiDevA::fastConv_3D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi)
+    {
+        int size = m_size, half = k_size / 2;
+
+        std::fill(o + row_lo * m_size * m_size, o + row_hi * m_size * m_size, 0.0f);
+
+        for (int i = row_lo; i < row_hi; i++)
+            for (int j = 0; j < size; j++)
+                for (int x = 0; x < k_size; x++)
+                    for (int y = 0; y < k_size; y++)
+                    {
+                        int m_i = i + x - half,
+                            m_j = j + y - half;
+
+                        if (m_i < 0 || m_i >= size ||
+                            m_j < 0 || m_j >= size)
+                            continue;
+
+                        for (int z = 0; z < k_size; z++)
+                        {
+                            int dz = z - half,
+                                w_lo = std::max(0, -dz),
+                                w_hi = std::min(size, size - dz);
+
+                            if (w_lo < w_hi)
+                                gemmini_simd::axpy(
+                                    o + (i * size + j) * size + w_lo,
+                                    m + (m_i * size + m_j) * size + w_lo + dz,
+                                    k[(x * k_size + y) * k_size + z],
+                                    w_hi - w_lo
+                                );
+                        }
+                    }
+    }
+
+    void
+    GemminiDevA::fastMaxPool(float *m, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi)
+    {
+        assert(m_size % k_size == 0);
+
+        unsigned int o_cols = m_size / k_size;
+
+        // Walk m row by row instead of window by window
+        for (int i = row_lo; i < row_hi; i++)
+        {
+            float *o_row = o + i * o_cols;
+
+            for (int j = 0; j < o_cols; j++)
+                o_row[j] = m[i * k_size * m_size + j * k_size];
+
+            for (int w = 0; w < k_size; w++)
+            {
+                float *m_row = m + (i * k_size + w) * m_size;
+
+                for (int j = 0; j < o_cols; j++)
+                    for (int x = 0; x < k_size; x++)
+                    {
+                        float v = m_row[j * k_size + x];
+                        o_row[j] = (v > o_row[j]) ? v : o_row[j];
+                    }
+            }
+        }
+    }
+
+    void
+    GemminiDevA::fastMM(float *a, float *b, float *c, unsigned int m_size, unsigned int row_lo, unsigned int row_hi)
+    {
+        std::fill(c + row_lo * m_size, c + row_hi * m_size, 0.0f);
+
+        for (unsigned int ii = row_lo; ii < row_hi; ii += mmTileRows)
+            for (unsigned int jj = 0; jj < m_size; jj += mmTileCols)
+                for (unsigned int ww = 0; ww < m_size; ww += mmTileDepth)
+                {
+                    unsigned int i_hi = std::min(ii + mmTileRows, row_hi),
+                                 j_len = std::min(mmTileCols, m_size - jj),
+                                 w_hi = std::min(ww + mmTileDepth, m_size);
+
+                    for (unsigned int i = ii; i < i_hi; i++)
+                        for (unsigned int w = ww; w < w_hi; w++)
+                            gemmini_simd::axpy(
+                                c + i * m_size + jj,
+                                b + w * m_size + jj,
+                                a[i * m_size + w],
+                                j_len
+                            );
+                }
+    }
+
+    void
+    GemminiDevA::transposeK()
+    {
+        unsigned int dim = pi_size_m;
+
+        kT.resize(dim * dim);
+
+        for (int i = 0; i < dim; i++)
+            for (int j = 0; j < dim; j++)
+                kT[j * dim + i] = k[i * dim + j];
+    }
+
+    void
+    GemminiDevA::fastMMGemm(float *a, float *b, float *c, unsigned int m_size, unsigned int row_lo, unsigned int row_hi)
+    {
+        // b is the transposed operand already restored by transposeK
+        fastMM(a, b, c, m_size, row_lo, row_hi);
+    }
+
     void 
     GemminiDevA::printMatrix_2D(float *m, unsigned int m_size)
     {
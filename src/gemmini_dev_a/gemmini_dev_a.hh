@@ -1,8 +1,12 @@
 #ifndef __GemminiDevA_HH__
 #define __GemminiDevA_HH__
 
+#include <vector>
+
 #include "ndp/ndp.hh"
+#include "gemmini_dev_a/gemmini_simd.hh"
 
+#include "enums/GemminiDataflow.hh"
 #include "params/GemminiDevA.hh"
 #include "debug/GemminiDevA.hh"
 #include "debug/GemminiDevAPI.hh"
@@ -24,24 +28,155 @@ namespace gem5
             op_maxpool_gemm,
             op_relu,
             op_mm,
-            op_mm_gemm
+            op_mm_gemm,
+            num_ops
         } GemminiDevAOP;
 
+        // Operations of layer descriptors
+        typedef enum GemminiDevALayerOP_
+        {
+            layer_conv2d,
+            layer_matmul,
+            layer_maxpool,
+            layer_relu
+        } GemminiDevALayerOP;
+
+        // Element types of the tensors of a layer descriptor
+        typedef enum GemminiDevAType_
+        {
+            type_fp32,
+            type_int32,
+            type_int8
+        } GemminiDevAType;
+
+        // Tensor in memory: N, C, H, W dimensions and the stride of each
+        // dimension, both in elements
+        struct TensorDesc
+        {
+            uint64_t addr;
+            uint64_t dims[4];
+            uint64_t strides[4];
+        };
+
+        // Layer descriptor the host places in memory and points r8 to.
+        // Convolutions read weights as K x C x R x S, pooling uses
+        // window_h x window_w, and matmuls multiply every H x W matrix of
+        // in by the matching (or only) matrix of wt.
+        struct LayerDesc
+        {
+            uint64_t op, dtype;
+            uint64_t stride_h, stride_w;
+            uint64_t pad_h, pad_w;
+            uint64_t window_h, window_w;
+            TensorDesc in, wt, out;
+        };
+
+        enum TensorId
+        {
+            tensor_in,
+            tensor_wt,
+            tensor_out,
+            num_tensors
+        };
+
+        enum LayerState
+        {
+            layer_fetch_desc,
+            layer_fetch_data,
+            layer_write
+        };
+
         uint64_t pi_addr_m = 0,
                  pi_addr_k = 0,
                  pi_addr_o = 0,
                  pi_size_m = 0,
                  pi_size_k = 0,
                  pi_opcode = 0,
-                 pi_status = 1;
+                 pi_status = 1,
+                 pi_addr_desc = 0;
 
-        unsigned int has_operands = 0;
+        // Start of the running job, for its latency statistics
+        Tick jobStart = 0;
+
+        // State of the running layer descriptor job
+        bool layerJob = false;
+        LayerDesc layer;
+        LayerState layerState;
+        uint64_t layerPending;
+        std::vector<float> layerData[num_tensors];      // Dense NCHW
+        std::vector<uint8_t> layerRows[num_tensors];    // Rows as in memory
+        EventFunctionWrapper layerEvent;
 
         float *m, *k, *o;
         size_t m_size, k_size, o_size;
 
+        // Use the cache-blocked, vectorized kernels and, optionally, check
+        // them bit-by-bit against the scalar reference kernels. The check
+        // only holds if both round every product and sum separately, so
+        // gemmini_dev_a.cc and gemmini_simd.cc are built with
+        // -ffp-contract=off (see SConscript)
+        bool simdKernels, checkKernels;
+
+        // Systolic array timing model
+        uint64_t saRows, saCols;
+        enums::GemminiDataflow dataflow;
+        uint64_t spadRows, accRows;
+
+        // The output is produced in tiles of tileRows rows. The operands of
+        // the next tile are fetched while the current tile computes and the
+        // output of each tile is written back as soon as it is computed.
+        uint64_t oRows, oRowElems, tileRows, numTiles;
+        Cycles jobCycles;
+        uint64_t mFetched;                  // Elements of m requested so far
+        std::vector<uint8_t *> tileFetch;   // Buffer each tile fetch lands in
+        std::vector<bool> tileLoaded;
+        uint64_t fetchedTiles, loadedTiles, computedTiles, writtenTiles;
+        bool kLoaded;
+
+        // k of op_mm_gemm in the layout of fastMM, restored once per job
+        std::vector<float> kT;
+
+        void transposeK();
+
+        EventFunctionWrapper computeEvent;
+
+        Cycles systolicCycles(uint64_t i_size, uint64_t j_size, uint64_t k_size);
+
+        Cycles computeCycles();
+
+        void planTiles();
+
+        void tileInput(uint64_t row_lo, uint64_t row_hi, uint64_t &m_lo, uint64_t &m_hi);
+
+        void fetchTiles();
+
+        void tryCompute();
+
+        void finishCompute();
+
         void process_fsm();
 
+        void compute(float *o, bool simd, uint64_t row_lo, uint64_t row_hi);
+
+        size_t layerElemSize()
+        { return layer.dtype == type_int8 ? 1 : sizeof(float); };
+
+        void startLayer();
+
+        void accessTensor(TensorId id, bool write);
+
+        void unpackTensor(TensorId id);
+
+        void packTensor(TensorId id);
+
+        void computeLayer();
+
+        Cycles layerCycles();
+
+        void writeLayer();
+
+        void layerRecvData(Addr addr, uint8_t *data, size_t size);
+
     public:
 
         GemminiDevA(const GemminiDevAParams &params);
@@ -50,18 +185,30 @@ namespace gem5
 
         void writePI(uint64_t ridx, uint64_t data) override;
 
+        bool peekPI(uint64_t ridx, uint64_t &data) override;
+
+        bool pokePI(uint64_t ridx, uint64_t data) override;
+
+        bool busy() const override
+        { return !pi_status; }
+
         void recvData(Addr addr, uint8_t *data, size_t size) override;
 
         /* ==================== BEGIN SPECIFIC METHODS ==================== */
 
-        void baseConv_2D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size);
-        void baseConv_3D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size);
-        void baseConvGemm(float *a, float *k, float *o, unsigned int o_size, unsigned int k_size);
-        void baseMaxPool(float *m, float *o, unsigned int m_size, unsigned int k_size);
-        void baseMaxPoolGemm(float *a, float *o, unsigned int m_size, unsigned int k_size);
-        void baseRelu(float *m, float *o, unsigned int m_size);
-        void baseMM(float *a, float *b, float *c, unsigned int m_size);
-        void baseMMGemm(float *a, float *b, float *c, unsigned int m_size);
+        void baseConv_2D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi);
+        void baseConv_3D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi);
+        void baseConvGemm(float *a, float *k, float *o, unsigned int o_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi);
+        void baseMaxPool(float *m, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi);
+        void baseMaxPoolGemm(float *a, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi);
+        void baseRelu(float *m, float *o, unsigned int m_size, unsigned int row_lo, unsigned int row_hi);
+        void baseMM(float *a, float *b, float *c, unsigned int m_size, unsigned int row_lo, unsigned int row_hi);
+        void baseMMGemm(float *a, float *b, float *c, unsigned int m_size, unsigned int row_lo, unsigned int row_hi);
+        void fastConv_2D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi);
+        void fastConv_3D(float *m, float *k, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi);
+        void fastMaxPool(float *m, float *o, unsigned int m_size, unsigned int k_size, unsigned int row_lo, unsigned int row_hi);
+        void fastMM(float *a, float *b, float *c, unsigned int m_size, unsigned int row_lo, unsigned int row_hi);
+        void fastMMGemm(float *a, float *b, float *c, unsigned int m_size, unsigned int row_lo, unsigned int row_hi);
         void printMatrix_2D(float *m, unsigned int m_size);
         void printMatrix_3D(float *m, unsigned int m_size);
 
@@ -0,0 +1,100 @@
+#include "gemmini_dev_a/gemmini_simd.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GEMMINI_SIMD_AVX2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define GEMMINI_SIMD_NEON
+#endif
+
+namespace gem5
+{
+    namespace gemmini_simd
+    {
+        namespace
+        {
+            void
+            axpyScalar(float *o, const float *m, float k, size_t n)
+            {
+                for (size_t j = 0; j < n; j++)
+                    o[j] += m[j] * k;
+            }
+
+#if defined(GEMMINI_SIMD_AVX2)
+            __attribute__((target("avx2"))) void
+            axpyAVX2(float *o, const float *m, float k, size_t n)
+            {
+                __m256 vk = _mm256_set1_ps(k);
+                size_t j = 0;
+
+                for (; j + 8 <= n; j += 8)
+                {
+                    __m256 vm = _mm256_mul_ps(_mm256_loadu_ps(m + j), vk);
+                    _mm256_storeu_ps(o + j, _mm256_add_ps(_mm256_loadu_ps(o + j), vm));
+                }
+
+                for (; j < n; j++)
+                    o[j] += m[j] * k;
+            }
+#elif defined(GEMMINI_SIMD_NEON)
+            void
+            axpyNEON(float *o, const float *m, float k, size_t n)
+            {
+                float32x4_t vk = vdupq_n_f32(k);
+                size_t j = 0;
+
+                for (; j + 4 <= n; j += 4)
+                {
+                    float32x4_t vm = vmulq_f32(vld1q_f32(m + j), vk);
+                    vst1q_f32(o + j, vaddq_f32(vld1q_f32(o + j), vm));
+                }
+
+                for (; j < n; j++)
+                    o[j] += m[j] * k;
+            }
+#endif
+
+            typedef void (*AxpyFn)(float *, const float *, float, size_t);
+
+            struct Dispatch
+            {
+                AxpyFn axpy = axpyScalar;
+                const char *isa = "scalar";
+
+                Dispatch()
+                {
+#if defined(GEMMINI_SIMD_AVX2)
+                    if (__builtin_cpu_supports("avx2"))
+                    {
+                        axpy = axpyAVX2;
+                        isa = "avx2";
+                    }
+#elif defined(GEMMINI_SIMD_NEON)
+                    axpy = axpyNEON;
+                    isa = "neon";
+#endif
+                }
+            };
+
+            const Dispatch &
+            dispatch()
+            {
+                static const Dispatch d;
+                return d;
+            }
+        }
+
+        void
+        axpy(float *o, const float *m, float k, size_t n)
+        {
+            dispatch().axpy(o, m, k, n);
+        }
+
+        const char *
+        isa()
+        {
+            return dispatch().isa;
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef __GemminiSIMD_HH__
+#define __GemminiSIMD_HH__
+
+#include <cstddef>
+
+namespace gem5
+{
+    namespace gemmini_simd
+    {
+        /**
+         * o[j] += m[j] * k for j in [0, n), vectorized with the widest
+         * instruction set the host supports (AVX2 or NEON). Products and
+         * sums are rounded separately, as in the scalar expression, so the
+         * result is bit-exact with a scalar loop.
+         */
+        void axpy(float *o, const float *m, float k, size_t n);
+
+        /** Instruction set axpy dispatches to on this host. */
+        const char *isa();
+    }
+}
+
+#endif //__GemminiSIMD_HH__
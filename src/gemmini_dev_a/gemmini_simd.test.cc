@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "gemmini_dev_a/gemmini_simd.hh"
+
+using namespace gem5;
+
+// The vectorized axpy must match a scalar loop bit-by-bit, for every
+// length (including the scalar tail) and for signed zeros
+TEST(GemminiSIMDTest, AxpyBitExact)
+{
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dist(-8.0f, 8.0f);
+
+    for (size_t n = 0; n < 70; n++)
+    {
+        std::vector<float> m(n), o(n), ref(n);
+
+        for (size_t j = 0; j < n; j++)
+        {
+            m[j] = (j % 5 == 0) ? -0.0f : dist(gen);
+            o[j] = ref[j] = dist(gen);
+        }
+
+        for (int r = 0; r < 4; r++)
+        {
+            float k = dist(gen);
+
+            gemmini_simd::axpy(o.data(), m.data(), k, n);
+            for (size_t j = 0; j < n; j++)
+                ref[j] += m[j] * k;
+        }
+
+        EXPECT_EQ(0, memcmp(o.data(), ref.data(), n * sizeof(float)))
+            << "Mismatch for n = " << n << " using " << gemmini_simd::isa();
+    }
+}
+
+TEST(GemminiSIMDTest, AxpyUnaligned)
+{
+    std::vector<float> m(40, 2.0f), o(40, 1.0f);
+
+    gemmini_simd::axpy(o.data() + 3, m.data() + 1, 0.5f, 33);
+
+    for (size_t j = 0; j < o.size(); j++)
+        EXPECT_EQ((j >= 3 && j < 36) ? 2.0f : 1.0f, o[j]);
+}
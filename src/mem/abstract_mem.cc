@@ -40,8 +40,10 @@
 
 #include "mem/abstract_mem.hh"
 
+#include <algorithm>
 #include <vector>
 
+#include "base/intmath.hh"
 #include "base/loader/memory_image.hh"
 #include "base/loader/object_file.hh"
 #include "cpu/thread_context.hh"
@@ -114,6 +116,28 @@ AbstractMemory::setBackingStore(uint8_t* pmem_addr)
     pmemAddr = pmem_addr;
 }
 
+void
+AbstractMemory::trackDirtyPages()
+{
+    // Interleaved memories address the whole span of their backing store
+    dirtyPages.assign(divCeil(range.end() - range.start(), DirtyPageBytes),
+                      false);
+    backdoorDirty = false;
+}
+
+void
+AbstractMemory::clearDirtyPages()
+{
+    if (dirtyPages.empty())
+        return;
+
+    std::fill(dirtyPages.begin(), dirtyPages.end(), false);
+    if (backdoorDirty) {
+        backdoor.invalidate();
+        backdoorDirty = false;
+    }
+}
+
 AbstractMemory::MemStats::MemStats(AbstractMemory &_mem)
     : statistics::Group(&_mem), mem(_mem),
     ADD_STAT(bytesRead, statistics::units::Byte::get(),
@@ -399,6 +423,7 @@ AbstractMemory::access(PacketPtr pkt)
             if (pmemAddr) {
                 pkt->setData(host_addr);
                 (*(pkt->getAtomicOp()))(host_addr);
+                markDirty(host_addr, pkt->getSize());
             }
         } else {
             std::vector<uint8_t> overwrite_val(pkt->getSize());
@@ -427,8 +452,10 @@ AbstractMemory::access(PacketPtr pkt)
                     panic("Invalid size for conditional read/write\n");
             }
 
-            if (overwrite_mem)
+            if (overwrite_mem) {
                 std::memcpy(host_addr, &overwrite_val[0], pkt->getSize());
+                markDirty(host_addr, pkt->getSize());
+            }
 
             assert(!pkt->req->isInstFetch());
             TRACE_PACKET("Read/Write");
@@ -460,6 +487,7 @@ AbstractMemory::access(PacketPtr pkt)
         if (writeOK(pkt)) {
             if (pmemAddr) {
                 pkt->writeData(host_addr);
+                markDirty(host_addr, pkt->getSize());
                 DPRINTF(MemoryAccess, "%s write due to %s\n",
                         __func__, pkt->print());
             }
@@ -493,6 +521,7 @@ AbstractMemory::functionalAccess(PacketPtr pkt)
     } else if (pkt->isWrite()) {
         if (pmemAddr) {
             pkt->writeData(host_addr);
+            markDirty(host_addr, pkt->getSize());
         }
         TRACE_PACKET("Write");
         pkt->makeResponse();
@@ -46,6 +46,8 @@
 #ifndef __MEM_ABSTRACT_MEMORY_HH__
 #define __MEM_ABSTRACT_MEMORY_HH__
 
+#include <vector>
+
 #include "mem/backdoor.hh"
 #include "mem/port.hh"
 #include "params/AbstractMemory.hh"
@@ -120,6 +122,27 @@ class AbstractMemory : public ClockedObject
     // Backdoor to access this memory.
     MemBackdoor backdoor;
 
+    // Pages of the backing store written since the dirty pages were
+    // last cleared, indexed by their offset from pmemAddr. Empty unless
+    // dirty pages are tracked.
+    std::vector<bool> dirtyPages;
+
+    // A backdoor was handed out since the dirty pages were last cleared,
+    // and writes through it cannot be tracked
+    bool backdoorDirty = false;
+
+    // Record a write of size bytes to host memory at host_addr
+    void
+    markDirty(const uint8_t* host_addr, unsigned size)
+    {
+        if (dirtyPages.empty() || !size)
+            return;
+        const Addr offset = host_addr - pmemAddr;
+        for (Addr page = offset / DirtyPageBytes;
+             page <= (offset + size - 1) / DirtyPageBytes; page++)
+            dirtyPages[page] = true;
+    }
+
     // Enable specific memories to be reported to the configuration table
     const bool confTableReported;
 
@@ -237,10 +260,40 @@ class AbstractMemory : public ClockedObject
     void
     getBackdoor(MemBackdoorPtr &bd_ptr)
     {
-        if (lockedAddrList.empty() && backdoor.ptr())
+        if (lockedAddrList.empty() && backdoor.ptr()) {
             bd_ptr = &backdoor;
+            backdoorDirty = !dirtyPages.empty();
+        }
     }
 
+    /** Granularity of dirty page tracking. */
+    static constexpr Addr DirtyPageBytes = 4096;
+
+    /**
+     * Start tracking the pages of the backing store that are written
+     * through this memory, e.g. to take incremental checkpoints.
+     */
+    void trackDirtyPages();
+
+    /**
+     * Forget the pages written so far. Backdoors are invalidated, so
+     * that their holders have to ask for them again and they are
+     * accounted for from now on.
+     */
+    void clearDirtyPages();
+
+    /**
+     * Get the dirty pages, indexed by their offset in the backing store
+     * of this memory. Empty if dirty pages are not tracked.
+     */
+    const std::vector<bool> &getDirtyPages() const { return dirtyPages; }
+
+    /**
+     * Whether any page of the backing store may have been written
+     * through a backdoor since the dirty pages were last cleared.
+     */
+    bool isBackdoorDirty() const { return backdoorDirty; }
+
     /**
      * Get the list of locked addresses to allow checkpointing.
      */
@@ -835,15 +835,31 @@ MemPacket*
 DRAMInterface::decodePacket(const PacketPtr pkt, Addr pkt_addr,
                        unsigned size, bool is_read, uint8_t pseudo_channel)
 {
-    // decode the address based on the address mapping scheme, with
-    // Ro, Ra, Co, Ba and Ch denoting row, rank, column, bank and
-    // channel, respectively
     uint8_t rank;
     uint8_t bank;
     // use a 64-bit unsigned during the computations as the row is
     // always the top bits, and check before creating the packet
     uint64_t row;
 
+    decodeAddr(pkt_addr, rank, bank, row);
+
+    // create the corresponding memory packet with the entry time and
+    // ready time set to the current tick, the latter will be updated
+    // later
+    uint16_t bank_id = banksPerRank * rank + bank;
+
+    return new MemPacket(pkt, is_read, true, pseudo_channel, rank, bank, row,
+                   bank_id, pkt_addr, size);
+}
+
+void
+DRAMInterface::decodeAddr(Addr pkt_addr, uint8_t &rank, uint8_t &bank,
+                          uint64_t &row)
+{
+    // decode the address based on the address mapping scheme, with
+    // Ro, Ra, Co, Ba and Ch denoting row, rank, column, bank and
+    // channel, respectively
+
     // Get packed address, starting at 0
     Addr addr = getCtrlAddr(pkt_addr);
 
@@ -907,14 +923,132 @@ DRAMInterface::decodePacket(const PacketPtr pkt, Addr pkt_addr,
 
     DPRINTF(DRAM, "Address: %#x Rank %d Bank %d Row %d\n",
             pkt_addr, rank, bank, row);
+}
 
-    // create the corresponding memory packet with the entry time and
-    // ready time set to the current tick, the latter will be updated
-    // later
-    uint16_t bank_id = banksPerRank * rank + bank;
+Tick
+DRAMInterface::nearBankAccess(Addr addr, Addr size, bool is_read)
+{
+    const Tick col_delay = is_read ? tCCD_L : tCCD_L_WR;
+    const Tick act_delay = is_read ? tRCD_RD : tRCD_WR;
+    const unsigned int units = nearBankUnits();
+
+    // Per-unit progress: time of the next column command, time the
+    // current row was activated, and the row the unit has open
+    std::vector<Tick> col_at(units, MaxTick);
+    std::vector<Tick> act_at(units, 0);
+    std::vector<uint32_t> open_row(units, Bank::NO_ROW);
+
+    // Activations share the limits of their rank (tRRD and tXAW) with
+    // the controller. They are paced in the order the scan reaches them,
+    // which never lets a later one overtake an earlier one.
+    std::vector<Tick> last_act(ranksPerChannel);
+    std::vector<uint8_t> last_group(ranksPerChannel, 0);
+    std::vector<std::deque<Tick>> act_window(ranksPerChannel);
+    for (uint8_t r = 0; r < ranksPerChannel; r++) {
+        act_window[r] = ranks[r]->actTicks;
+        last_act[r] = act_window[r].empty() ? 0 : act_window[r].front();
+    }
 
-    return new MemPacket(pkt, is_read, true, pseudo_channel, rank, bank, row,
-                   bank_id, pkt_addr, size);
+    auto activate = [&](uint8_t rank, const Bank &bank_ref, Tick act_tick) {
+        if (last_act[rank]) {
+            bool same_group = bankGroupArch &&
+                              bank_ref.bankgr == last_group[rank];
+            act_tick = std::max(act_tick, last_act[rank] +
+                                (same_group ? tRRD_L : tRRD));
+        }
+
+        std::deque<Tick> &window = act_window[rank];
+        if (!window.empty()) {
+            // no more than activationLimit activations in any tXAW
+            if (window.back())
+                act_tick = std::max(act_tick, window.back() + tXAW);
+            window.pop_back();
+            window.push_front(act_tick);
+        }
+
+        last_act[rank] = act_tick;
+        last_group[rank] = bank_ref.bankgr;
+        return act_tick;
+    };
+
+    for (Addr burst_addr = addr - addr % burstSize; burst_addr < addr + size;
+         burst_addr += burstSize) {
+        uint8_t rank;
+        uint8_t bank;
+        uint64_t row;
+        decodeAddr(burst_addr, rank, bank, row);
+
+        uint16_t bank_id = banksPerRank * rank + bank;
+        const Bank &bank_ref = ranks[rank]->banks[bank];
+
+        if (col_at[bank_id] == MaxTick) {
+            // the unit takes over the bank once the controller is done
+            col_at[bank_id] = std::max({curTick(), bank_ref.rdAllowedAt,
+                                        bank_ref.wrAllowedAt});
+            open_row[bank_id] = bank_ref.openRow;
+        }
+
+        if (open_row[bank_id] != row) {
+            if (open_row[bank_id] != Bank::NO_ROW) {
+                col_at[bank_id] = std::max(col_at[bank_id],
+                                           act_at[bank_id] + tRAS) + tRP;
+            }
+            act_at[bank_id] = activate(rank, bank_ref,
+                std::max(col_at[bank_id], bank_ref.actAllowedAt));
+            col_at[bank_id] = act_at[bank_id] + act_delay;
+            open_row[bank_id] = row;
+        }
+
+        col_at[bank_id] += col_delay;
+    }
+
+    Tick done_at = curTick();
+
+    for (uint16_t bank_id = 0; bank_id < units; bank_id++) {
+        if (col_at[bank_id] == MaxTick)
+            continue;
+
+        Bank &bank_ref = ranks[bank_id / banksPerRank]->banks[bank_id %
+                                                               banksPerRank];
+        Tick free_at = col_at[bank_id];
+
+        // restore the row the controller expects to find open
+        if (open_row[bank_id] != bank_ref.openRow) {
+            free_at = std::max(free_at, act_at[bank_id] + tRAS) + tRP;
+            if (bank_ref.openRow != Bank::NO_ROW) {
+                free_at = activate(bank_id / banksPerRank, bank_ref,
+                                   free_at) + act_delay;
+            }
+        }
+
+        bank_ref.rdAllowedAt = std::max(bank_ref.rdAllowedAt, free_at);
+        bank_ref.wrAllowedAt = std::max(bank_ref.wrAllowedAt, free_at);
+        bank_ref.preAllowedAt = std::max(bank_ref.preAllowedAt, free_at);
+        bank_ref.actAllowedAt = std::max(bank_ref.actAllowedAt, free_at);
+
+        done_at = std::max(done_at, col_at[bank_id] + (is_read ? tRL : tWL));
+    }
+
+    // the controller's next activations follow the near-bank ones
+    for (uint8_t r = 0; r < ranksPerChannel; r++) {
+        if (!last_act[r] || act_window[r] == ranks[r]->actTicks)
+            continue;
+
+        ranks[r]->actTicks = act_window[r];
+
+        for (Bank &bank_ref : ranks[r]->banks) {
+            bool same_group = bankGroupArch && bank_ref.bankgr == last_group[r];
+            Tick allowed_at = last_act[r] + (same_group ? tRRD_L : tRRD);
+            if (!act_window[r].empty() && act_window[r].back())
+                allowed_at = std::max(allowed_at, act_window[r].back() + tXAW);
+            bank_ref.actAllowedAt = std::max(bank_ref.actAllowedAt, allowed_at);
+        }
+    }
+
+    DPRINTF(DRAM, "Near-bank %s of %d bytes at %#x done at %lld\n",
+            is_read ? "read" : "write", size, addr, done_at);
+
+    return done_at;
 }
 
 void DRAMInterface::setupRank(const uint8_t rank, const bool is_read)
@@ -670,6 +670,36 @@ class DRAMInterface : public MemInterface
                            unsigned int size, bool is_read,
                            uint8_t pseudo_channel = 0) override;
 
+    /**
+     * Address decoder shared by decodePacket and the near-bank units
+     *
+     * @param pkt_addr The address to decode
+     * @param rank Rank the address maps to
+     * @param bank Bank (within the rank) the address maps to
+     * @param row Row the address maps to
+     */
+    void decodeAddr(Addr pkt_addr, uint8_t &rank, uint8_t &bank,
+                    uint64_t &row);
+
+    /**
+     * Every bank streams its share of the range through its own compute
+     * unit, so banks proceed in parallel and column accesses within a bank
+     * are paced by tCCD_L rather than by the channel burst time. Rows are
+     * opened as needed and the row the controller left open is restored
+     * afterwards, so the bank state seen by the controller is unchanged,
+     * apart from the banks being busy until the near-bank access is over.
+     * Activations are paced by tRRD and tXAW across the banks of a rank,
+     * together with the ones of the controller. Refresh and power-down
+     * are not modelled for near-bank accesses.
+     */
+    Tick nearBankAccess(Addr addr, Addr size, bool is_read) override;
+
+    unsigned int
+    nearBankUnits() const override
+    {
+        return ranksPerChannel * banksPerRank;
+    }
+
     /**
      * Iterate through dram ranks to exit self-refresh in order to drain
      */
@@ -1364,6 +1364,28 @@ MemCtrl::recvFunctional(PacketPtr pkt)
              pkt->print());
 }
 
+Tick
+MemCtrl::nearBankAccess(PacketPtr pkt)
+{
+    panic_if(!pkt->getAddrRange().isSubset(dram->getAddrRange()),
+             "Near-bank access %s is not within the controller range\n",
+             pkt->print());
+
+    Tick done_at = dram->nearBankAccess(pkt->getAddr(), pkt->getSize(),
+                                        pkt->isRead());
+
+    // the data moves between the banks and the units only
+    dram->functionalAccess(pkt);
+
+    return done_at;
+}
+
+unsigned int
+MemCtrl::nearBankUnits() const
+{
+    return dram->nearBankUnits();
+}
+
 bool
 MemCtrl::recvFunctionalLogic(PacketPtr pkt, MemInterface* mem_intr)
 {
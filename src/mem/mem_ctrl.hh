@@ -686,6 +686,21 @@ class MemCtrl : public qos::MemCtrl
 
     DrainState drain() override;
 
+    /**
+     * Access a range from compute units placed next to the DRAM banks
+     * (near-bank processing). The data is moved functionally and never
+     * crosses the channel, and the banks are busy for the time it takes.
+     *
+     * @param pkt Read or write of a range within this controller
+     * @return Tick at which the access completes
+     */
+    Tick nearBankAccess(PacketPtr pkt);
+
+    /**
+     * @return number of compute units placed next to the banks
+     */
+    unsigned int nearBankUnits() const;
+
     /**
      * Check for command bus contention for single cycle command.
      * If there is contention, shift command to next burst.
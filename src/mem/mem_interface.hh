@@ -307,6 +307,32 @@ class MemInterface : public AbstractMemory
         return nullptr;
     }
 
+    /**
+     * Timing of a range accessed by compute units placed next to the
+     * banks (near-bank processing). The data never crosses the channel,
+     * so only the bank timing constrains the access.
+     *
+     * @param addr The starting address of the range
+     * @param size The size of the range in bytes
+     * @param is_read Is the range read or written by the compute units
+     * @return Tick at which the last burst of the range is accessed
+     */
+    virtual Tick
+    nearBankAccess(Addr addr, Addr size, bool is_read)
+    {
+        panic("MemInterface does not support near-bank processing.\n");
+        return MaxTick;
+    }
+
+    /**
+     * @return number of near-bank compute units, one per bank
+     */
+    virtual unsigned int
+    nearBankUnits() const
+    {
+        return 1;
+    }
+
     /**
      *  Add rank to rank delay to bus timing to all banks in all ranks
      *  when access to an alternate interface is issued
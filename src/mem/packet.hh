@@ -56,6 +56,7 @@
 #include "base/cast.hh"
 #include "base/compiler.hh"
 #include "base/flags.hh"
+#include "base/freelist.hh"
 #include "base/logging.hh"
 #include "base/printable.hh"
 #include "base/types.hh"
@@ -352,6 +353,9 @@ class Packet : public Printable
         /// the packet is destroyed. The pointer is assumed to be pointing
         /// to an array, and delete [] is consequently called
         DYNAMIC_DATA           = 0x00002000,
+        /// The dynamic data was taken from the freelist of small data
+        /// buffers and goes back to it when the packet is destroyed.
+        POOLED_DATA            = 0x00004000,
 
         /// suppress the error if this packet encounters a functional
         /// access failure.
@@ -364,6 +368,11 @@ class Packet : public Printable
 
     Flags flags;
 
+    /// Data of up to this many bytes (a cache line in most systems) is
+    /// allocated from a freelist rather than the heap.
+    static constexpr unsigned PooledDataSize = 64;
+    typedef FreeList<PooledDataSize> DataFreeList;
+
   public:
     typedef MemCmd::Command Command;
 
@@ -1051,6 +1060,27 @@ class Packet : public Printable
         deleteData();
     }
 
+    /**
+     * Packets are created and destroyed on every memory access, so they
+     * are recycled through a thread-local freelist.
+     */
+    static void *
+    operator new(size_t size)
+    {
+        if (size == sizeof(Packet))
+            return FreeList<sizeof(Packet)>::allocate();
+        return ::operator new(size);
+    }
+
+    static void
+    operator delete(void *p, size_t size)
+    {
+        if (size == sizeof(Packet))
+            FreeList<sizeof(Packet)>::release(p);
+        else
+            ::operator delete(p);
+    }
+
     /**
      * Take a request packet and modify it in place to be suitable for
      * returning as a response to that request.
@@ -1342,10 +1372,12 @@ class Packet : public Printable
     void
     deleteData()
     {
-        if (flags.isSet(DYNAMIC_DATA))
+        if (flags.isSet(POOLED_DATA))
+            DataFreeList::release(data);
+        else if (flags.isSet(DYNAMIC_DATA))
             delete [] data;
 
-        flags.clear(STATIC_DATA|DYNAMIC_DATA);
+        flags.clear(STATIC_DATA|DYNAMIC_DATA|POOLED_DATA);
         data = NULL;
     }
 
@@ -1358,7 +1390,12 @@ class Packet : public Printable
         if (hasData() || hasRespData()) {
             assert(flags.noneSet(STATIC_DATA|DYNAMIC_DATA));
             flags.set(DYNAMIC_DATA);
-            data = new uint8_t[getSize()];
+            if (getSize() <= PooledDataSize) {
+                flags.set(POOLED_DATA);
+                data = static_cast<uint8_t *>(DataFreeList::allocate());
+            } else {
+                data = new uint8_t[getSize()];
+            }
         }
     }
 
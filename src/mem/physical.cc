@@ -44,11 +44,15 @@
 #include <unistd.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <climits>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "base/intmath.hh"
 #include "base/trace.hh"
@@ -76,15 +80,62 @@ namespace gem5
 namespace memory
 {
 
+namespace
+{
+
+/**
+ * Canonical absolute path of a directory, without a trailing '/'.
+ */
+std::string
+realDir(const std::string& dir)
+{
+    char* path = realpath(dir.c_str(), NULL);
+    fatal_if(!path, "Can't resolve checkpoint directory '%s'\n", dir);
+    std::string real(path);
+    free(path);
+    return real;
+}
+
+/**
+ * Path of dir as seen from from. Checkpoints of the same simulation
+ * usually share their parent directory, and are then referred to
+ * relatively so that they can be moved together.
+ */
+std::string
+relativeDir(const std::string& dir, const std::string& from)
+{
+    const auto dir_sep = dir.rfind('/');
+    const auto from_sep = from.rfind('/');
+    if (dir_sep != std::string::npos && dir_sep == from_sep &&
+        !dir.compare(0, dir_sep, from, 0, from_sep))
+        return "../" + dir.substr(dir_sep + 1);
+    return dir;
+}
+
+} // anonymous namespace
+
 PhysicalMemory::PhysicalMemory(const std::string& _name,
                                const std::vector<AbstractMemory*>& _memories,
                                bool mmap_using_noreserve,
                                const std::string& shared_backstore,
-                               bool auto_unlink_shared_backstore) :
+                               bool auto_unlink_shared_backstore,
+                               MemoryCheckpointFormat cpt_format,
+                               unsigned cpt_threads,
+                               uint64_t cpt_block_size,
+                               bool cpt_delta) :
     _name(_name), size(0), mmapUsingNoReserve(mmap_using_noreserve),
     sharedBackstore(shared_backstore), sharedBackstoreSize(0),
-    pageSize(sysconf(_SC_PAGE_SIZE))
+    pageSize(sysconf(_SC_PAGE_SIZE)), cptFormat(cpt_format),
+    storeFile(cpt_threads ? cpt_threads :
+              std::max(std::thread::hardware_concurrency(), 1u),
+              cpt_block_size, pageSize),
+    cptDelta(cpt_delta), backingStoreExposed(false)
 {
+    fatal_if(cpt_block_size == 0 || cpt_block_size % pageSize ||
+             cpt_block_size > UINT32_MAX,
+             "Memory checkpoint block size %d must be a multiple of the "
+             "page size (%d) below 4GiB\n", cpt_block_size, pageSize);
+
     // Register cleanup callback if requested.
     if (auto_unlink_shared_backstore && !sharedBackstore.empty()) {
         registerExitCallback([=]() { shm_unlink(shared_backstore.c_str()); });
@@ -254,11 +305,15 @@ PhysicalMemory::createBackingStore(
                               conf_table_reported, in_addr_map, kvm_map,
                               shm_fd, map_offset);
 
+    storeMemories.push_back(_memories);
+
     // point the memories to their backing store
     for (const auto& m : _memories) {
         DPRINTF(AddrRanges, "Mapping memory %s to backing store\n",
                 m->name());
         m->setBackingStore(pmem);
+        if (cptDelta)
+            m->trackDirtyPages();
     }
 }
 
@@ -357,6 +412,15 @@ PhysicalMemory::serialize(CheckpointOut &cp) const
         ScopedCheckpointSection sec(cp, csprintf("store%d", store_id));
         serializeStore(cp, store_id++, s.range, s.pmem);
     }
+
+    // the next checkpoint only needs the pages written from now on
+    if (cptDelta) {
+        cptParent = realDir(CheckpointIn::dir());
+        for (const auto& mems : storeMemories) {
+            for (const auto& m : mems)
+                m->clearDirtyPages();
+        }
+    }
 }
 
 void
@@ -378,10 +442,58 @@ PhysicalMemory::serializeStore(CheckpointOut &cp, unsigned int store_id,
 
     // write memory file
     std::string filepath = CheckpointIn::dir() + "/" + filename.c_str();
+
+    // The file may be mapped by this very simulation if it restored a raw
+    // store from the same checkpoint. Replace it rather than truncate it,
+    // whatever the new format, so that the mapping keeps the old contents.
+    if (unlink(filepath.c_str()) && errno != ENOENT)
+        fatal("Can't replace physical memory checkpoint file '%s'\n",
+              filepath);
+
+    // only store the pages written since the parent checkpoint, unless
+    // there is none or they are not known
+    const std::string cpt_dir =
+        cptDelta ? realDir(CheckpointIn::dir()) : std::string();
+    if (cptDelta && !cptParent.empty() && cptParent != cpt_dir) {
+        std::vector<bool> dirty;
+        if (getStoreDirtyPages(store_id, dirty)) {
+            std::string format = "delta";
+            std::string parent = relativeDir(cptParent, cpt_dir);
+            SERIALIZE_SCALAR(format);
+            SERIALIZE_SCALAR(parent);
+            storeFile.writeDelta(filepath, pmem, range.size(), dirty,
+                                 AbstractMemory::DirtyPageBytes);
+            return;
+        }
+        warn("Writes to %s are not tracked, checkpointing it in full\n",
+             filename);
+    }
+
+    std::string format =
+        MemoryCheckpointFormatStrings[static_cast<int>(cptFormat)];
+    SERIALIZE_SCALAR(format);
+
+    switch (cptFormat) {
+      case MemoryCheckpointFormat::chunked:
+        storeFile.writeChunked(filepath, pmem, range.size());
+        break;
+      case MemoryCheckpointFormat::raw:
+        storeFile.writeRaw(filepath, pmem, range.size());
+        break;
+      default:
+        writeGzipStore(filepath, range, pmem);
+        break;
+    }
+}
+
+void
+PhysicalMemory::writeGzipStore(const std::string& filepath, AddrRange range,
+                               uint8_t* pmem) const
+{
     gzFile compressed_mem = gzopen(filepath.c_str(), "wb");
     if (compressed_mem == NULL)
         fatal("Can't open physical memory checkpoint file '%s'\n",
-              filename);
+              filepath);
 
     uint64_t pass_size = 0;
 
@@ -394,7 +506,7 @@ PhysicalMemory::serializeStore(CheckpointOut &cp, unsigned int store_id,
         if (gzwrite(compressed_mem, pmem + written,
                     (unsigned int) pass_size) != (int) pass_size) {
             fatal("Write failed on physical memory checkpoint file '%s'\n",
-                  filename);
+                  filepath);
         }
     }
 
@@ -402,8 +514,7 @@ PhysicalMemory::serializeStore(CheckpointOut &cp, unsigned int store_id,
     // is zero
     if (gzclose(compressed_mem))
         fatal("Close failed on physical memory checkpoint file '%s'\n",
-              filename);
-
+              filepath);
 }
 
 void
@@ -429,13 +540,19 @@ PhysicalMemory::unserialize(CheckpointIn &cp)
         unserializeStore(cp);
     }
 
+    // the checkpoint we restored from is the parent of the next one
+    if (cptDelta) {
+        cptParent = realDir(cp.getCptDir());
+        for (const auto& mems : storeMemories) {
+            for (const auto& m : mems)
+                m->clearDirtyPages();
+        }
+    }
 }
 
 void
 PhysicalMemory::unserializeStore(CheckpointIn &cp)
 {
-    const uint32_t chunk_size = 16384;
-
     unsigned int store_id;
     UNSERIALIZE_SCALAR(store_id);
 
@@ -443,10 +560,8 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
     UNSERIALIZE_SCALAR(filename);
     std::string filepath = cp.getCptDir() + "/" + filename;
 
-    // mmap memoryfile
-    gzFile compressed_mem = gzopen(filepath.c_str(), "rb");
-    if (compressed_mem == NULL)
-        fatal("Can't open physical memory checkpoint file '%s'", filename);
+    std::string format = "gzip";
+    UNSERIALIZE_OPT_SCALAR(format);
 
     // we've already got the actual backing store mapped
     uint8_t* pmem = backingStore[store_id].pmem;
@@ -462,6 +577,55 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
         fatal("Memory range size has changed! Saw %lld, expected %lld\n",
               range_size, range.size());
 
+    if (format == "delta") {
+        // restore the whole chain of parents first, a relative parent is
+        // relative to the directory of this checkpoint
+        std::string parent;
+        UNSERIALIZE_SCALAR(parent);
+        if (parent.empty() || parent[0] != '/')
+            parent = cp.getCptDir() + parent;
+
+        DPRINTF(Checkpoint, "Restoring the parent of %s from %s\n",
+                filename, parent);
+        {
+            CheckpointIn parent_cp(parent);
+            unserializeStore(parent_cp);
+        }
+        // opening the parent changed the current checkpoint directory
+        CheckpointIn::setDir(cp.getCptDir());
+
+        storeFile.readDelta(filepath, pmem, range.size());
+    } else if (format == "chunked") {
+        storeFile.readChunked(filepath, pmem, range.size());
+    } else if (format == "raw") {
+        // A shared backing store must stay shared with the other
+        // processes, so it cannot be replaced and is filled instead
+        if (backingStore[store_id].shmFd != -1) {
+            storeFile.readRaw(filepath, pmem, range.size());
+        } else {
+            storeFile.mapRaw(filepath, pmem, range.size(),
+                             mmapUsingNoReserve);
+            DPRINTF(Checkpoint, "Mapped %s copy-on-write for range %s\n",
+                    filepath, range.to_string());
+        }
+    } else if (format == "gzip") {
+        readGzipStore(filepath, range, pmem);
+    } else {
+        fatal("Unknown format '%s' of physical memory checkpoint file "
+              "'%s'\n", format, filename);
+    }
+}
+
+void
+PhysicalMemory::readGzipStore(const std::string& filepath, AddrRange range,
+                              uint8_t* pmem) const
+{
+    const uint32_t chunk_size = 16384;
+
+    gzFile compressed_mem = gzopen(filepath.c_str(), "rb");
+    if (compressed_mem == NULL)
+        fatal("Can't open physical memory checkpoint file '%s'", filepath);
+
     uint64_t curr_size = 0;
     long* temp_page = new long[chunk_size];
     long* pmem_current;
@@ -488,7 +652,30 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
 
     if (gzclose(compressed_mem))
         fatal("Close failed on physical memory checkpoint file '%s'\n",
-              filename);
+              filepath);
+}
+
+bool
+PhysicalMemory::getStoreDirtyPages(unsigned int store_id,
+                                   std::vector<bool>& dirty) const
+{
+    if (backingStoreExposed)
+        return false;
+
+    dirty.assign(divCeil(backingStore[store_id].range.size(),
+                         AbstractMemory::DirtyPageBytes), false);
+
+    // all the memories of a store index it from its start
+    for (const auto& m : storeMemories[store_id]) {
+        const std::vector<bool>& pages = m->getDirtyPages();
+        if (pages.empty() || m->isBackdoorDirty())
+            return false;
+        for (size_t i = 0; i < pages.size() && i < dirty.size(); i++) {
+            if (pages[i])
+                dirty[i] = true;
+        }
+    }
+    return true;
 }
 
 } // namespace memory
@@ -44,7 +44,9 @@
 
 #include "base/addr_range.hh"
 #include "base/addr_range_map.hh"
+#include "enums/MemoryCheckpointFormat.hh"
 #include "mem/packet.hh"
+#include "mem/store_file.hh"
 #include "sim/serialize.hh"
 
 namespace gem5
@@ -158,10 +160,27 @@ class PhysicalMemory : public Serializable
 
     long pageSize;
 
+    // Format of the backing stores in new checkpoints, and the writer
+    // and reader of the formats other than gzip
+    const MemoryCheckpointFormat cptFormat;
+    const StoreFile storeFile;
+
+    // Write only the pages that changed since the last checkpoint this
+    // simulation took or restored from (the parent), if there is one
+    const bool cptDelta;
+    mutable std::string cptParent;
+
+    // The backing store was handed out to be accessed directly (e.g. by
+    // KVM), so writes to it can no longer be tracked
+    mutable bool backingStoreExposed;
+
     // The physical memory used to provide the memory in the simulated
     // system
     std::vector<BackingStoreEntry> backingStore;
 
+    // The memories using each backing store
+    std::vector<std::vector<AbstractMemory*>> storeMemories;
+
     // Prevent copying
     PhysicalMemory(const PhysicalMemory&);
 
@@ -182,6 +201,29 @@ class PhysicalMemory : public Serializable
                             bool conf_table_reported,
                             bool in_addr_map, bool kvm_map);
 
+    /**
+     * Write a backing store as a single gzip stream.
+     */
+    void writeGzipStore(const std::string& filepath, AddrRange range,
+                        uint8_t* pmem) const;
+
+    /**
+     * Read a backing store written by writeGzipStore.
+     */
+    void readGzipStore(const std::string& filepath, AddrRange range,
+                       uint8_t* pmem) const;
+
+    /**
+     * Collect the pages of a backing store written since the parent
+     * checkpoint.
+     *
+     * @param store_id The backing store
+     * @param dirty Set to whether each page is dirty
+     * @return false if the written pages are not known
+     */
+    bool getStoreDirtyPages(unsigned int store_id,
+                            std::vector<bool>& dirty) const;
+
   public:
 
     /**
@@ -191,7 +233,12 @@ class PhysicalMemory : public Serializable
                    const std::vector<AbstractMemory*>& _memories,
                    bool mmap_using_noreserve,
                    const std::string& shared_backstore,
-                   bool auto_unlink_shared_backstore);
+                   bool auto_unlink_shared_backstore,
+                   MemoryCheckpointFormat cpt_format=
+                       MemoryCheckpointFormat::gzip,
+                   unsigned cpt_threads=0,
+                   uint64_t cpt_block_size=1 << 20,
+                   bool cpt_delta=false);
 
     /**
      * Unmap all the backing store we have used.
@@ -242,8 +289,12 @@ class PhysicalMemory : public Serializable
      *
      * @return Pointers to the memory backing store
      */
-    std::vector<BackingStoreEntry> getBackingStore() const
-    { return backingStore; }
+    std::vector<BackingStoreEntry>
+    getBackingStore() const
+    {
+        backingStoreExposed = true;
+        return backingStore;
+    }
 
     /**
      * Perform an untimed memory access and update all the state
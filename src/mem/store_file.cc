@@ -0,0 +1,517 @@
+#include "mem/store_file.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "debug/Checkpoint.hh"
+
+/**
+ * On Linux, MAP_NORESERVE allow us to simulate a very large memory
+ * without committing to actually providing the swap space on the
+ * host. On FreeBSD or OSX the MAP_NORESERVE flag does not exist,
+ * so simply make it 0.
+ */
+#if defined(__APPLE__) || defined(__FreeBSD__)
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#endif
+
+namespace gem5
+{
+
+namespace memory
+{
+
+namespace
+{
+
+/**
+ * Layout of chunked backing store files: a header, the compressed
+ * non-zero blocks in the order they were compressed, and an index with
+ * one entry per block at indexOffset. Integers are in host byte order.
+ */
+struct ChunkedStoreHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t blockSize;
+    uint64_t rangeSize;
+    uint64_t numBlocks;
+    uint64_t indexOffset;
+};
+
+struct ChunkedStoreIndexEntry
+{
+    /** Offset of the compressed block in the file. */
+    uint64_t offset;
+    /** Size of the compressed block, 0 if it is all zero. */
+    uint64_t size;
+};
+
+const char chunkedStoreMagic[8] = {'g', 'e', 'm', '5', 'p', 'm', 'e', 'm'};
+const uint32_t chunkedStoreVersion = 1;
+
+/**
+ * Layout of delta backing store files: a header, the compressed runs of
+ * dirty pages and an index of the runs at indexOffset.
+ */
+struct DeltaStoreHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t pageBytes;
+    uint64_t rangeSize;
+    uint64_t numRuns;
+    uint64_t indexOffset;
+};
+
+struct DeltaStoreRun
+{
+    /** Offset and size of the run of pages in the backing store. */
+    uint64_t start;
+    uint64_t length;
+    /** Offset of the compressed run in the file. */
+    uint64_t offset;
+    /** Size of the compressed run, 0 if it is all zero. */
+    uint64_t size;
+};
+
+const char deltaStoreMagic[8] = {'g', 'e', 'm', '5', 'd', 'e', 'l', 't'};
+const uint32_t deltaStoreVersion = 1;
+
+bool
+isZero(const uint8_t* p, uint64_t size)
+{
+    const uint64_t* words = (const uint64_t*)p;
+    for (uint64_t i = 0; i < size / sizeof(uint64_t); i++) {
+        if (words[i])
+            return false;
+    }
+    for (uint64_t i = size & ~(sizeof(uint64_t) - 1); i < size; i++) {
+        if (p[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Run work on every item in [0, n) using up to threads threads, the
+ * calling one included. Stops handing out items once work fails.
+ *
+ * @return Whether work succeeded on every item
+ */
+bool
+parallelFor(uint64_t n, unsigned threads,
+            const std::function<bool(uint64_t)>& work)
+{
+    std::atomic<uint64_t> next(0);
+    std::atomic<bool> ok(true);
+
+    auto worker = [&]() {
+        for (uint64_t i = next++; i < n && ok; i = next++) {
+            if (!work(i))
+                ok = false;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (uint64_t t = 1; t < threads && t < n; t++)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool)
+        t.join();
+
+    return ok;
+}
+
+bool
+preadAll(int fd, void* buf, uint64_t size, uint64_t offset)
+{
+    uint8_t* p = (uint8_t*)buf;
+    while (size) {
+        ssize_t ret = pread(fd, p, size, offset);
+        if (ret <= 0) {
+            if (ret < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+        p += ret;
+        size -= ret;
+        offset += ret;
+    }
+    return true;
+}
+
+bool
+pwriteAll(int fd, const void* buf, uint64_t size, uint64_t offset)
+{
+    const uint8_t* p = (const uint8_t*)buf;
+    while (size) {
+        ssize_t ret = pwrite(fd, p, size, offset);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += ret;
+        size -= ret;
+        offset += ret;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+StoreFile::StoreFile(unsigned threads, uint64_t block_size,
+                     uint64_t page_size) :
+    threads(threads), blockSize(block_size), pageSize(page_size)
+{
+}
+
+void
+StoreFile::writeChunked(const std::string& filepath, const uint8_t* pmem,
+                        uint64_t size) const
+{
+    int fd = open(filepath.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0664);
+    if (fd == -1)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filepath);
+
+    const uint64_t num_blocks = divCeil(size, blockSize);
+    std::vector<ChunkedStoreIndexEntry> index(num_blocks);
+
+    // Blocks are appended in whatever order the threads finish
+    // compressing them, the index records where each one went
+    std::atomic<uint64_t> end(sizeof(ChunkedStoreHeader));
+
+    bool ok = parallelFor(num_blocks, threads, [&](uint64_t i) {
+        const uint64_t start = i * blockSize;
+        const uint64_t length = std::min(blockSize, size - start);
+
+        index[i].offset = 0;
+        index[i].size = 0;
+        if (isZero(pmem + start, length))
+            return true;
+
+        std::vector<uint8_t> compressed(compressBound(length));
+        uLongf compressed_size = compressed.size();
+        if (compress2(compressed.data(), &compressed_size, pmem + start,
+                      length, Z_BEST_SPEED) != Z_OK)
+            return false;
+
+        index[i].offset = end.fetch_add(compressed_size);
+        index[i].size = compressed_size;
+        return pwriteAll(fd, compressed.data(), compressed_size,
+                         index[i].offset);
+    });
+
+    ChunkedStoreHeader header;
+    memcpy(header.magic, chunkedStoreMagic, sizeof(header.magic));
+    header.version = chunkedStoreVersion;
+    header.blockSize = blockSize;
+    header.rangeSize = size;
+    header.numBlocks = num_blocks;
+    header.indexOffset = end;
+
+    if (!ok ||
+        !pwriteAll(fd, index.data(),
+                   num_blocks * sizeof(ChunkedStoreIndexEntry),
+                   header.indexOffset) ||
+        !pwriteAll(fd, &header, sizeof(header), 0))
+        fatal("Write failed on physical memory checkpoint file '%s'\n",
+              filepath);
+
+    if (close(fd))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              filepath);
+
+    DPRINTF(Checkpoint, "Wrote %d blocks of %d bytes in %d bytes using "
+            "%d threads\n", num_blocks, blockSize,
+            header.indexOffset - sizeof(header), threads);
+}
+
+void
+StoreFile::readChunked(const std::string& filepath, uint8_t* pmem,
+                       uint64_t size) const
+{
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd == -1)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filepath);
+
+    ChunkedStoreHeader header;
+    if (!preadAll(fd, &header, sizeof(header), 0) ||
+        memcmp(header.magic, chunkedStoreMagic, sizeof(header.magic)) ||
+        header.version != chunkedStoreVersion ||
+        header.rangeSize != size || header.blockSize == 0 ||
+        header.numBlocks != divCeil(header.rangeSize, header.blockSize))
+        fatal("Physical memory checkpoint file '%s' is not a chunked "
+              "store of %d bytes\n", filepath, size);
+
+    const uint64_t block_size = header.blockSize;
+    std::vector<ChunkedStoreIndexEntry> index(header.numBlocks);
+    if (!preadAll(fd, index.data(),
+                  header.numBlocks * sizeof(ChunkedStoreIndexEntry),
+                  header.indexOffset))
+        fatal("Can't read the index of physical memory checkpoint file "
+              "'%s'\n", filepath);
+
+    bool ok = parallelFor(header.numBlocks, threads, [&](uint64_t i) {
+        // All-zero blocks are already zero in the fresh backing store
+        if (!index[i].size)
+            return true;
+
+        const uint64_t start = i * block_size;
+        const uint64_t length = std::min(block_size, size - start);
+
+        std::vector<uint8_t> compressed(index[i].size);
+        std::vector<uint8_t> block(length);
+        uLongf block_size_read = length;
+        if (!preadAll(fd, compressed.data(), index[i].size,
+                      index[i].offset) ||
+            uncompress(block.data(), &block_size_read, compressed.data(),
+                       index[i].size) != Z_OK ||
+            block_size_read != length)
+            return false;
+
+        // Only copy pages that are non-zero, so that the zero pages of
+        // the backing store are never touched
+        for (uint64_t off = 0; off < length; off += pageSize) {
+            uint64_t len = std::min<uint64_t>(pageSize, length - off);
+            if (!isZero(block.data() + off, len))
+                memcpy(pmem + start + off, block.data() + off, len);
+        }
+        return true;
+    });
+
+    if (!ok)
+        fatal("Read failed on physical memory checkpoint file '%s'\n",
+              filepath);
+
+    close(fd);
+}
+
+void
+StoreFile::writeRaw(const std::string& filepath, const uint8_t* pmem,
+                    uint64_t size) const
+{
+    int fd = open(filepath.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0664);
+    if (fd == -1)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filepath);
+
+    // All-zero blocks are left as holes, which read back as zeros
+    if (ftruncate(fd, size))
+        fatal("Can't size physical memory checkpoint file '%s'\n",
+              filepath);
+
+    const uint64_t num_blocks = divCeil(size, blockSize);
+    bool ok = parallelFor(num_blocks, threads, [&](uint64_t i) {
+        const uint64_t start = i * blockSize;
+        const uint64_t length = std::min(blockSize, size - start);
+        return isZero(pmem + start, length) ||
+            pwriteAll(fd, pmem + start, length, start);
+    });
+
+    if (!ok)
+        fatal("Write failed on physical memory checkpoint file '%s'\n",
+              filepath);
+
+    if (close(fd))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              filepath);
+}
+
+void
+StoreFile::readRaw(const std::string& filepath, uint8_t* pmem,
+                   uint64_t size) const
+{
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd == -1)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filepath);
+
+    struct stat st;
+    if (fstat(fd, &st) || (uint64_t)st.st_size != size)
+        fatal("Physical memory checkpoint file '%s' is not a raw store of "
+              "%d bytes\n", filepath, size);
+
+    const uint64_t num_blocks = divCeil(size, blockSize);
+    bool ok = parallelFor(num_blocks, threads, [&](uint64_t i) {
+        const uint64_t start = i * blockSize;
+        return preadAll(fd, pmem + start,
+                        std::min(blockSize, size - start), start);
+    });
+    if (!ok)
+        fatal("Read failed on physical memory checkpoint file '%s'\n",
+              filepath);
+
+    close(fd);
+}
+
+void
+StoreFile::mapRaw(const std::string& filepath, uint8_t* pmem, uint64_t size,
+                  bool no_reserve) const
+{
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd == -1)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filepath);
+
+    struct stat st;
+    if (fstat(fd, &st) || (uint64_t)st.st_size != size)
+        fatal("Physical memory checkpoint file '%s' is not a raw store of "
+              "%d bytes\n", filepath, size);
+
+    // Replace the memory at the same address, so that the users of the
+    // backing store keep pointing to it
+    int map_flags = MAP_PRIVATE | MAP_FIXED;
+    if (no_reserve)
+        map_flags |= MAP_NORESERVE;
+
+    uint8_t* mapped = (uint8_t*) mmap(pmem, size, PROT_READ | PROT_WRITE,
+                                      map_flags, fd, 0);
+    if (mapped != pmem) {
+        perror("mmap");
+        fatal("Could not map physical memory checkpoint file '%s'\n",
+              filepath);
+    }
+
+    // The mapping holds its own reference to the file
+    close(fd);
+}
+
+void
+StoreFile::writeDelta(const std::string& filepath, const uint8_t* pmem,
+                      uint64_t size, const std::vector<bool>& dirty,
+                      uint64_t page_bytes) const
+{
+    // coalesce dirty pages into runs of up to a block
+    std::vector<DeltaStoreRun> runs;
+    for (uint64_t page = 0; page < dirty.size(); page++) {
+        if (!dirty[page])
+            continue;
+        const uint64_t start = page * page_bytes;
+        const uint64_t length = std::min(page_bytes, size - start);
+        if (!runs.empty() &&
+            runs.back().start + runs.back().length == start &&
+            runs.back().length + length <= blockSize)
+            runs.back().length += length;
+        else
+            runs.push_back({start, length, 0, 0});
+    }
+
+    int fd = open(filepath.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0664);
+    if (fd == -1)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filepath);
+
+    std::atomic<uint64_t> end(sizeof(DeltaStoreHeader));
+
+    bool ok = parallelFor(runs.size(), threads, [&](uint64_t i) {
+        DeltaStoreRun& run = runs[i];
+        if (isZero(pmem + run.start, run.length))
+            return true;
+
+        std::vector<uint8_t> compressed(compressBound(run.length));
+        uLongf compressed_size = compressed.size();
+        if (compress2(compressed.data(), &compressed_size, pmem + run.start,
+                      run.length, Z_BEST_SPEED) != Z_OK)
+            return false;
+
+        run.offset = end.fetch_add(compressed_size);
+        run.size = compressed_size;
+        return pwriteAll(fd, compressed.data(), compressed_size,
+                         run.offset);
+    });
+
+    DeltaStoreHeader header;
+    memcpy(header.magic, deltaStoreMagic, sizeof(header.magic));
+    header.version = deltaStoreVersion;
+    header.pageBytes = page_bytes;
+    header.rangeSize = size;
+    header.numRuns = runs.size();
+    header.indexOffset = end;
+
+    if (!ok ||
+        !pwriteAll(fd, runs.data(), runs.size() * sizeof(DeltaStoreRun),
+                   header.indexOffset) ||
+        !pwriteAll(fd, &header, sizeof(header), 0))
+        fatal("Write failed on physical memory checkpoint file '%s'\n",
+              filepath);
+
+    if (close(fd))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              filepath);
+
+    DPRINTF(Checkpoint, "Wrote %d runs of dirty pages in %d bytes\n",
+            runs.size(), header.indexOffset - sizeof(header));
+}
+
+void
+StoreFile::readDelta(const std::string& filepath, uint8_t* pmem,
+                     uint64_t size) const
+{
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd == -1)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filepath);
+
+    DeltaStoreHeader header;
+    if (!preadAll(fd, &header, sizeof(header), 0) ||
+        memcmp(header.magic, deltaStoreMagic, sizeof(header.magic)) ||
+        header.version != deltaStoreVersion ||
+        header.rangeSize != size)
+        fatal("Physical memory checkpoint file '%s' is not a delta "
+              "store of %d bytes\n", filepath, size);
+
+    std::vector<DeltaStoreRun> runs(header.numRuns);
+    if (!preadAll(fd, runs.data(), runs.size() * sizeof(DeltaStoreRun),
+                  header.indexOffset))
+        fatal("Can't read the index of physical memory checkpoint file "
+              "'%s'\n", filepath);
+
+    bool ok = parallelFor(runs.size(), threads, [&](uint64_t i) {
+        const DeltaStoreRun& run = runs[i];
+        if (run.start + run.length > size)
+            return false;
+
+        // the parent may hold data where the run became zero
+        if (!run.size) {
+            memset(pmem + run.start, 0, run.length);
+            return true;
+        }
+
+        std::vector<uint8_t> compressed(run.size);
+        uLongf length = run.length;
+        return preadAll(fd, compressed.data(), run.size, run.offset) &&
+            uncompress(pmem + run.start, &length, compressed.data(),
+                       run.size) == Z_OK &&
+            length == run.length;
+    });
+
+    if (!ok)
+        fatal("Read failed on physical memory checkpoint file '%s'\n",
+              filepath);
+
+    close(fd);
+}
+
+} // namespace memory
+} // namespace gem5
@@ -0,0 +1,92 @@
+#ifndef __MEM_STORE_FILE_HH__
+#define __MEM_STORE_FILE_HH__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gem5
+{
+
+namespace memory
+{
+
+/**
+ * Writes the backing stores of physical memory to checkpoint files in
+ * the chunked, raw and delta formats, and reads them back. Stores are
+ * split into blocks that are handled by several threads at once. The
+ * writers truncate existing files, so a file that mapRaw may have mapped
+ * must be unlinked before it is written again.
+ */
+class StoreFile
+{
+  private:
+
+    // Threads to use, the calling one included
+    const unsigned threads;
+
+    // Bytes of memory compressed, written or read at a time
+    const uint64_t blockSize;
+
+    // Host page size, the granularity at which zeros are skipped
+    const uint64_t pageSize;
+
+  public:
+
+    StoreFile(unsigned threads, uint64_t block_size, uint64_t page_size);
+
+    /**
+     * Write a backing store as independently compressed blocks. All-zero
+     * blocks are not stored and an index at the end of the file locates
+     * the others.
+     */
+    void writeChunked(const std::string& filepath, const uint8_t* pmem,
+                      uint64_t size) const;
+
+    /**
+     * Read a backing store written by writeChunked into zeroed memory.
+     */
+    void readChunked(const std::string& filepath, uint8_t* pmem,
+                     uint64_t size) const;
+
+    /**
+     * Write a backing store uncompressed, leaving holes for the
+     * all-zero blocks.
+     */
+    void writeRaw(const std::string& filepath, const uint8_t* pmem,
+                  uint64_t size) const;
+
+    /**
+     * Copy a backing store written by writeRaw into memory.
+     */
+    void readRaw(const std::string& filepath, uint8_t* pmem,
+                 uint64_t size) const;
+
+    /**
+     * Map a backing store written by writeRaw privately over the
+     * page-aligned memory at pmem, so that it is loaded on demand and
+     * modified pages are copied rather than written back to the file.
+     */
+    void mapRaw(const std::string& filepath, uint8_t* pmem, uint64_t size,
+                bool no_reserve) const;
+
+    /**
+     * Write the pages of a backing store marked in dirty, each
+     * page_bytes large, compressed in runs of up to a block.
+     */
+    void writeDelta(const std::string& filepath, const uint8_t* pmem,
+                    uint64_t size, const std::vector<bool>& dirty,
+                    uint64_t page_bytes) const;
+
+    /**
+     * Apply the pages written by writeDelta to memory that holds their
+     * parent.
+     */
+    void readDelta(const std::string& filepath, uint8_t* pmem,
+                   uint64_t size) const;
+};
+
+} // namespace memory
+} // namespace gem5
+
+#endif //__MEM_STORE_FILE_HH__
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/intmath.hh"
+#include "mem/store_file.hh"
+
+using namespace gem5;
+using namespace gem5::memory;
+
+namespace
+{
+
+// Size of the pages in the dirty page maps, as in AbstractMemory
+const uint64_t DirtyPageBytes = 4096;
+
+/**
+ * Page-aligned anonymous memory that reads as zero until written, like
+ * a fresh backing store.
+ */
+class Store
+{
+  public:
+    Store(uint64_t size) : size(size)
+    {
+        pmem = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        EXPECT_NE(pmem, MAP_FAILED);
+    }
+
+    ~Store() { munmap(pmem, size); }
+
+    uint8_t *pmem;
+    const uint64_t size;
+};
+
+class StoreFileTest : public testing::Test
+{
+  protected:
+    void
+    SetUp() override
+    {
+        char dir[] = "/tmp/store_file.test.XXXXXX";
+        ASSERT_NE(mkdtemp(dir), nullptr);
+        cptDir = dir;
+    }
+
+    void
+    TearDown() override
+    {
+        for (const auto &file : files)
+            unlink(file.c_str());
+        rmdir(cptDir.c_str());
+    }
+
+    std::string
+    path(const std::string &name)
+    {
+        files.push_back(cptDir + "/" + name);
+        return files.back();
+    }
+
+    /**
+     * Fill a store with data, except for its second and fourth blocks,
+     * which stay all zero. The last block is partial.
+     */
+    void
+    fill(Store &store)
+    {
+        for (uint64_t i = 0; i < store.size; i++) {
+            const uint64_t block = i / blockSize;
+            if (block != 1 && block != 3)
+                store.pmem[i] = (i * 7 + block) % 251 + 1;
+        }
+    }
+
+    const uint64_t pageSize = sysconf(_SC_PAGE_SIZE);
+    const uint64_t blockSize = 4 * pageSize;
+    // Five whole blocks and a partial one of three pages
+    const uint64_t size = 5 * blockSize + 3 * pageSize;
+    const StoreFile storeFile{4, blockSize, (uint64_t)pageSize};
+
+    std::string cptDir;
+    std::vector<std::string> files;
+};
+
+} // anonymous namespace
+
+TEST_F(StoreFileTest, ChunkedRoundTrip)
+{
+    Store store(size);
+    fill(store);
+
+    const std::string file = path("chunked.pmem");
+    storeFile.writeChunked(file, store.pmem, size);
+
+    Store restored(size);
+    storeFile.readChunked(file, restored.pmem, size);
+
+    EXPECT_EQ(memcmp(store.pmem, restored.pmem, size), 0);
+}
+
+TEST_F(StoreFileTest, ChunkedAllZero)
+{
+    Store store(size);
+
+    const std::string file = path("chunked.pmem");
+    storeFile.writeChunked(file, store.pmem, size);
+
+    Store restored(size);
+    storeFile.readChunked(file, restored.pmem, size);
+
+    EXPECT_EQ(memcmp(store.pmem, restored.pmem, size), 0);
+}
+
+TEST_F(StoreFileTest, RawRoundTrip)
+{
+    Store store(size);
+    fill(store);
+
+    const std::string file = path("raw.pmem");
+    storeFile.writeRaw(file, store.pmem, size);
+
+    Store copied(size);
+    storeFile.readRaw(file, copied.pmem, size);
+    EXPECT_EQ(memcmp(store.pmem, copied.pmem, size), 0);
+
+    Store mapped(size);
+    storeFile.mapRaw(file, mapped.pmem, size, false);
+    EXPECT_EQ(memcmp(store.pmem, mapped.pmem, size), 0);
+}
+
+TEST_F(StoreFileTest, MappedRawIsCopyOnWrite)
+{
+    Store store(size);
+    fill(store);
+
+    const std::string file = path("raw.pmem");
+    storeFile.writeRaw(file, store.pmem, size);
+
+    // Writes to the mapping, including to a hole, stay out of the file
+    Store mapped(size);
+    storeFile.mapRaw(file, mapped.pmem, size, false);
+    memset(mapped.pmem, 0, pageSize);
+    memset(mapped.pmem + blockSize, 0xff, pageSize);
+
+    Store copied(size);
+    storeFile.readRaw(file, copied.pmem, size);
+    EXPECT_EQ(memcmp(store.pmem, copied.pmem, size), 0);
+}
+
+TEST_F(StoreFileTest, DeltaOnRawParent)
+{
+    Store store(size);
+    fill(store);
+
+    const std::string parent = path("parent.pmem");
+    storeFile.writeRaw(parent, store.pmem, size);
+
+    std::vector<bool> dirty(divCeil(size, DirtyPageBytes), false);
+    auto write = [&](uint64_t offset, uint8_t value, uint64_t bytes) {
+        memset(store.pmem + offset, value, bytes);
+        for (uint64_t page = offset / DirtyPageBytes;
+             page <= (offset + bytes - 1) / DirtyPageBytes; page++)
+            dirty[page] = true;
+    };
+
+    // Data in a zero block, a run that became all zero, data next to
+    // unchanged pages, and the end of the partial last block
+    write(blockSize + 100, 0x5a, 10);
+    write(2 * blockSize, 0, 2 * DirtyPageBytes);
+    write(4 * blockSize + DirtyPageBytes, 0xa5, 1);
+    write(size - 1, 0x3c, 1);
+
+    const std::string delta = path("delta.pmem");
+    storeFile.writeDelta(delta, store.pmem, size, dirty, DirtyPageBytes);
+
+    Store restored(size);
+    storeFile.mapRaw(parent, restored.pmem, size, false);
+    storeFile.readDelta(delta, restored.pmem, size);
+
+    EXPECT_EQ(memcmp(store.pmem, restored.pmem, size), 0);
+}
+
+TEST_F(StoreFileTest, DeltaWithoutDirtyPages)
+{
+    Store store(size);
+    fill(store);
+
+    const std::string parent = path("parent.pmem");
+    storeFile.writeChunked(parent, store.pmem, size);
+
+    const std::string delta = path("delta.pmem");
+    std::vector<bool> dirty(divCeil(size, DirtyPageBytes), false);
+    storeFile.writeDelta(delta, store.pmem, size, dirty, DirtyPageBytes);
+
+    Store restored(size);
+    storeFile.readChunked(parent, restored.pmem, size);
+    storeFile.readDelta(delta, restored.pmem, size);
+
+    EXPECT_EQ(memcmp(store.pmem, restored.pmem, size), 0);
+}
@@ -1,6 +1,7 @@
 from m5.params import *
 from m5.proxy import *
 from m5.objects.ClockedObject import ClockedObject
+from m5.objects.IntPin import IntSourcePin
 
 class NDP(ClockedObject):
     type = 'NDP'
@@ -10,10 +11,17 @@ class NDP(ClockedObject):
     cpu_side = ResponsePort("CPU side port, receives requests")
     mem_side = RequestPort("Memory side port, sends requests")
     dma_port = RequestPort("DMA port that connects the NDP device to the memory hierarchy")
+    int_pin = IntSourcePin("Interrupt raised when the NDP device completes a job")
     
     ndp_ctrl = Param.AddrRange(('0x40000000', '0x40001000'), "Memory Range reserved for the NDP device API")
     ndp_data = Param.AddrRange(('0x40001000', '0x80000000'), "Memory Range shared between the NDP device and the CPU")
     max_rsze = Param.Unsigned(0x800, "Maximum request size to memory")
-    max_reqs = Param.Unsigned(1, "Number of clock cycles between requests to prevent the overflow of the packet queue")
+    max_reqs = Param.Unsigned(1, "Maximum number of in-flight DMA requests (flow-control credits)")
+    dma_width = Param.Unsigned(1, "Maximum number of DMA requests issued per clock cycle")
+    zero_copy = Param.Bool(False, "DMA packets access the device buffer in place instead of a private copy")
+    tlb_entries = Param.Unsigned(0, "Entries of the device TLB, 0 to DMA on physical addresses")
+    walk_latency = Param.Cycles(100, "Latency of a device page walk on a TLB miss")
+    process = Param.Process(NULL, "Process whose virtual addresses the device DMA uses")
+    near_mem = Param.MemCtrl(NULL, "Memory controller whose banks host the compute units of the device (near-bank NDP)")
 
     system = Param.System(Parent.any, "The system this NDP device is part of")
@@ -1,20 +1,68 @@
 #include "ndp/ndp.hh"
 
+#include "base/cast.hh"
+#include "debug/Drain.hh"
+#include "mem/mem_ctrl.hh"
+#include "mem/page_table.hh"
+#include "sim/process.hh"
+
 namespace gem5
 {
 
 	NDP::NDP(const NDPParams &params) :
 	ClockedObject(params),
 	cpuPort(params.name + ".cpu_side", this),
-	memPort(params.name + ".mem_side", this),
-	dmaPort(params.name + ".dma_port", this),
+	memPort(params.name + ".mem_side", this, MemSidePort::role_cpu),
+	dmaPort(params.name + ".dma_port", this, MemSidePort::role_dma),
 	ndpCtrl(params.ndp_ctrl),
 	ndpData(params.ndp_data),
 	maxRSze(params.max_rsze),
-	maxReqs(params.max_reqs)
+	maxReqs(params.max_reqs),
+	dmaEvent([this] { sendData(); }, name() + ".dmaEvent"),
+	dmaWidth(params.dma_width),
+	dmaIssued(0),
+	dmaIssueTick(MaxTick),
+	dmaBlocked(false),
+	zeroCopy(params.zero_copy),
+	system(params.system),
+	intEnabled(false),
+	intPending(false),
+	tlb(nullptr),
+	walkLatency(params.walk_latency),
+	process(params.process),
+	walkerFreeTick(0),
+	nearMem(params.near_mem),
+	cmoAddr(0),
+	cmoSize(0),
+	cmoPending(false),
+	occupancyTick(0),
+	creditStallTick(MaxTick),
+	stats(*this)
 	{
+		fatal_if(maxReqs == 0, "NDP max_reqs must be at least 1.\n");
+		fatal_if(dmaWidth == 0, "NDP dma_width must be at least 1.\n");
+
+		fatal_if(
+			params.tlb_entries && !process,
+			"NDP tlb_entries requires the process whose page table is walked.\n"
+		);
+
+		fatal_if(
+			params.tlb_entries && nearMem,
+			"NDP near-bank placement only accesses physical addresses.\n"
+		);
+
 		flyReqs = 0;
-		dmaActv = false;
+		pendingBursts = 0;
+
+		if (params.tlb_entries)
+			tlb = new NDPTLB(params.tlb_entries);
+
+		for (int i = 0; i < params.port_int_pin_connection_count; i++)
+		{
+			intPin.push_back(new IntSourcePin<NDP>(
+				csprintf("%s.int_pin[%d]", name(), i), i, this));
+		}
 	}
 
 	Port &
@@ -26,6 +74,8 @@ namespace gem5
 			return cpuPort;
 		else if (if_name == "dma_port")
 			return dmaPort;
+		else if (if_name == "int_pin")
+			return *intPin.at(idx);
 		else
 			return ClockedObject::getPort(if_name, idx);
 	}
@@ -36,19 +86,35 @@ namespace gem5
 		return owner->getAddrRanges();
 	}
 
+	Tick
+	NDP::CPUSidePort::recvAtomic(PacketPtr pkt)
+	{
+		if (owner->ndpCtrl.contains(pkt->getAddr()))
+		{
+			owner->accessPI(pkt);
+
+			// Reading or writing the PI always takes one cycle
+			return owner->clockPeriod();
+		}
+		else
+			return owner->memPort.sendAtomic(pkt);
+	}
+
 	void
 	NDP::CPUSidePort::recvFunctional(PacketPtr pkt)
 	{
-		owner->memPort.sendFunctional(pkt);
+		if (owner->ndpCtrl.contains(pkt->getAddr()))
+			owner->accessPI(pkt, true);
+		else
+			owner->memPort.sendFunctional(pkt);
 	}
 
 	bool
 	NDP::CPUSidePort::recvTimingReq(PacketPtr pkt)
 	{
+		// Everything but the PI goes straight through the device
 		if (owner->ndpCtrl.contains(pkt->getAddr()))
 			return owner->handleRequest(pkt);
-		else if (owner->ndpData.contains(pkt->getAddr()))
-			return owner->memPort.sendTimingReq(pkt);
 		else
 			return owner->memPort.sendTimingReq(pkt);
 	}
@@ -59,31 +125,160 @@ namespace gem5
 		panic("CPUSidePort::recvRespRetry not implemented!\n");
 	}
 
-	bool
-	NDP::handleRequest(PacketPtr pkt)
+	void
+	NDP::accessPI(PacketPtr pkt, bool functional)
 	{
-		uint64_t data, ridx = (pkt->getAddr() - ndpCtrl.start()) / sizeof(uint64_t);
+		uint64_t ridx = (pkt->getAddr() - ndpCtrl.start()) / sizeof(uint64_t);
+		uint64_t words = pkt->getSize() / sizeof(uint64_t);
+
+		panic_if(
+			pkt->getSize() % sizeof(uint64_t) || !words,
+			"NDP PI access of %u bytes is not made of whole registers!\n",
+			pkt->getSize()
+		);
+
+		uint64_t *data = pkt->getPtr<uint64_t>();
 
-		if (pkt->isRead())
+		for (uint64_t i = 0; i < words; i++)
 		{
+			if (pkt->isRead())
+				data[i] = functional ? peekReg(ridx + i) : readReg(ridx + i);
+			else if (pkt->isWrite() && functional)
+				pokeReg(ridx + i, data[i]);
+			else if (pkt->isWrite())
+				writeReg(ridx + i, data[i]);
+			else
+				panic("NDP received packet that is not read nor write!\n");
+		}
+
+		if (pkt->needsResponse())
+			pkt->makeResponse();
+	}
+
+	bool
+	NDP::readBaseReg(uint64_t ridx, uint64_t &data)
+	{
+		if (ridx == cmoAddrReg())
+			data = cmoAddr;
+		else if (ridx == cmoSizeReg())
+			data = cmoSize;
+		else if (ridx == cmoCmdReg())
+			data = !cmoPending;
+		else if (ridx == tlbFlushReg() && tlb)
+			data = tlb->size();
+		else if (ridx == intEnableReg())
+			data = intEnabled;
+		else if (ridx == intStatusReg())
+			data = intPending;
+		else
+			return false;
+
+		return true;
+	}
+
+	uint64_t
+	NDP::readReg(uint64_t ridx)
+	{
+		uint64_t data;
+
+		if (!readBaseReg(ridx, data))
 			data = readPI(ridx);
-			pkt->setRaw<uint64_t>(data);
 
-			DPRINTF(NDPPI, "NDP PI read request: %p (%u)\n", ridx, data);
-		}
-		else if (pkt->isWrite())
+		DPRINTF(NDPPI, "NDP PI read request: %p (%u)\n", ridx, data);
+
+		return data;
+	}
+
+	uint64_t
+	NDP::peekReg(uint64_t ridx)
+	{
+		uint64_t data = 0;
+
+		if (!readBaseReg(ridx, data))
+			peekPI(ridx, data);
+
+		DPRINTF(NDPPI, "NDP PI functional read: %p (%u)\n", ridx, data);
+
+		return data;
+	}
+
+	void
+	NDP::pokeReg(uint64_t ridx, uint64_t data)
+	{
+		bool set = true;
+
+		// Commands, TLB flushes and the interrupt ignore functional writes
+		if (ridx == cmoAddrReg())
+			cmoAddr = data;
+		else if (ridx == cmoSizeReg())
+			cmoSize = data;
+		else if (ridx == cmoCmdReg() || ridx == tlbFlushReg() ||
+				 ridx == intEnableReg() || ridx == intStatusReg())
+			set = false;
+		else
+			set = pokePI(ridx, data);
+
+		DPRINTF(
+			NDPPI,
+			"NDP PI functional write: %p (%u)%s\n",
+			ridx, data, set ? "" : " ignored"
+		);
+	}
+
+	void
+	NDP::writeReg(uint64_t ridx, uint64_t data)
+	{
+		DPRINTF(NDPPI, "NDP PI write request: %p (%u)\n", ridx, data);
+
+		if (ridx == cmoAddrReg() || ridx == cmoSizeReg() || ridx == cmoCmdReg())
 		{
-			data = pkt->getRaw<uint64_t>();
-			writePI(ridx, data);
+			panic_if(
+				cmoPending,
+				"Tried to start cache maintenance while one is not finished!\n"
+			);
 
-			DPRINTF(NDPPI, "NDP PI write request: %p (%u)\n", ridx, data);
+			if (ridx == cmoAddrReg())
+				cmoAddr = data;
+			else if (ridx == cmoSizeReg())
+				cmoSize = data;
+			else if (data == 1 || data == 2)
+				maintainCaches(cmoAddr, cmoSize, data == 2);
+			else
+				panic("Invalid cache maintenance command %lu!\n", data);
 		}
-		else
+		else if (ridx == tlbFlushReg() && tlb)
+		{
+			DPRINTF(NDPPI, "NDP device TLB flushed\n");
+			tlb->flush();
+		}
+		else if (ridx == intEnableReg() || ridx == intStatusReg())
 		{
-			panic("NDP received packet that is not read nor write!\n");
+			bool wasRaised = intEnabled && intPending;
+
+			if (ridx == intEnableReg())
+				intEnabled = data != 0;
+			else
+				intPending = false;
+
+			DPRINTF(
+				NDPPI,
+				"NDP interrupt %s write: enabled %d, pending %d\n",
+				ridx == intEnableReg() ? "enable" : "status",
+				intEnabled,
+				intPending
+			);
+
+			updateInterrupt(wasRaised);
 		}
+		else
+			writePI(ridx, data);
+	}
+
+	bool
+	NDP::handleRequest(PacketPtr pkt)
+	{
+		accessPI(pkt);
 
-		pkt->makeResponse();
 		schedule(
 			new EventFunctionWrapper(
 				[this, pkt]
@@ -103,84 +298,204 @@ namespace gem5
 		return true;
 	}
 
+	Addr
+	NDP::translate(Addr vaddr, bool &miss)
+	{
+		EmulationPageTable *pTable = process->pTable;
+		Addr vpage = pTable->pageAlign(vaddr), ppage;
+
+		miss = !tlb->lookup(vpage, ppage);
+		if (miss)
+		{
+			// Walk the page table of the process
+			const EmulationPageTable::Entry *entry = pTable->lookup(vpage);
+			panic_if(
+				!entry,
+				"NDP device accessed unmapped virtual address %p!\n",
+				vaddr
+			);
+
+			ppage = entry->paddr;
+			tlb->insert(vpage, ppage);
+
+			DPRINTF(NDPMem, "NDP device TLB miss: %p -> %p\n", vpage, ppage);
+		}
+
+		return ppage + pTable->pageOffset(vaddr);
+	}
+
 	void
-	NDP::sendData()
+	NDP::notifyCompletion()
+	{
+		bool wasRaised = intEnabled && intPending;
+
+		intPending = true;
+		updateInterrupt(wasRaised);
+
+		checkDrain();
+	}
+
+	void
+	NDP::checkDrain()
 	{
-		// If maximum number of simultaneous requests was reached do nothing
-		if (flyReqs == maxReqs)
+		if (drainState() == DrainState::Draining && idle())
 		{
-			dmaActv = false;
-			return;
+			DPRINTF(Drain, "NDP device done draining\n");
+			signalDrainDone();
 		}
+	}
 
-		PacketPtr pkt = pendingReqPackets.front();
+	void
+	NDP::updateInterrupt(bool wasRaised)
+	{
+		// The line is level-triggered: high while enabled and pending
+		bool raised = intEnabled && intPending;
 
-		DPRINTF(
-			NDPMem,
-			"NDP device %s %lu bytes %s %p\n",
-			pkt->isWrite() ? "writing" : "reading",
-			pkt->getSize(),
-			pkt->isWrite() ? "to" : "from",
-			pkt->getAddr()
-		);
+		if (raised == wasRaised)
+			return;
+
+		DPRINTF(NDPPI, "NDP %s interrupt\n", raised ? "raising" : "clearing");
 
-		// Send oldest pending packet
-		if (dmaPort.sendTimingReq(pkt))
+		for (auto *pin : intPin)
 		{
-			flyReqs++;
+			if (raised)
+				pin->raise();
+			else
+				pin->lower();
+		}
+	}
 
-			// Remove pending packet from list
-			pendingReqPackets.pop_front();
+	void
+	NDP::sendData()
+	{
+		// A new cycle restores the full issue width
+		if (dmaIssueTick != curTick())
+		{
+			dmaIssueTick = curTick();
+			dmaIssued = 0;
+		}
 
-			// Schedule next packet
-			if (!pendingReqPackets.empty())
+		while (!pendingReqPackets.empty() && !dmaBlocked)
+		{
+			// No credits left, the next response will restart the engine
+			if (flyReqs >= maxReqs)
 			{
-				schedule(
-					new EventFunctionWrapper(
-						[this]
-						{
-							sendData();
-						},
-						name() + ".NDPAttemptMemoryRequest",
-						true
-					),
-					// Send the next packet on the next cycle
-					clockEdge(Cycles(1))
-				);
+				if (creditStallTick == MaxTick)
+					creditStallTick = curTick();
+				return;
 			}
-			else
+
+			// Issue width exhausted, continue on the next cycle
+			if (dmaIssued >= dmaWidth)
+			{
+				if (!dmaEvent.scheduled())
+					schedule(dmaEvent, clockEdge(Cycles(1)));
+				return;
+			}
+
+			PacketPtr pkt = pendingReqPackets.front();
+
+			// The page walk of the next packet is still in progress
+			Tick ready = safe_cast<SubRequestState *>(pkt->senderState)->readyTick;
+			if (ready > curTick())
+			{
+				if (!dmaEvent.scheduled())
+					schedule(dmaEvent, ready);
+				return;
+			}
+
+			DPRINTF(
+				NDPMem,
+				"NDP device %s %lu bytes %s %p\n",
+				pkt->isWrite() ? "writing" : "reading",
+				pkt->getSize(),
+				pkt->isWrite() ? "to" : "from",
+				pkt->getAddr()
+			);
+
+			// Memory is busy, wait for recvReqRetry
+			if (!dmaPort.sendTimingReq(pkt))
 			{
-				dmaActv = false;
+				stats.dmaRetries++;
+				dmaBlocked = true;
+				return;
 			}
+
+			updateOccupancy();
+			flyReqs++;
+			dmaIssued++;
+
+			// Remove pending packet from queue
+			pendingReqPackets.pop_front();
 		}
 	}
 
+	void
+	NDP::kickDMA()
+	{
+		// Wake up the DMA engine unless it is running or waiting for a retry
+		if (!dmaBlocked && !dmaEvent.scheduled() && !pendingReqPackets.empty())
+			schedule(dmaEvent, clockEdge());
+	}
+
 	void
 	NDP::accessMemory(Addr addr, size_t size, bool write, uint8_t *data)
 	{
+		if (write)
+		{
+			stats.bytesWritten += size;
+			stats.writeBursts++;
+		}
+		else
+		{
+			stats.bytesRead += size;
+			stats.readBursts++;
+		}
+
+		if (nearMem)
+		{
+			accessNearBank(addr, size, write, data);
+			return;
+		}
+
 		// Create new burst request
 		BurstRequest *newRequest = new BurstRequest(
 			AddrRange(addr, addr + size),
 			data,
 			write
 		);
+		pendingBursts++;
 
-		uint64_t nRequests = 0;
-		for (Addr saddr = addr; saddr < addr + size; saddr += maxRSze, ++nRequests)
+		// Atomic and functional CPUs (e.g., while fast-forwarding) cannot
+		// take timing responses, so memory is accessed atomically instead
+		bool atomic = !system->isTimingMode();
+		Tick latency = 0;
+
+		for (size_t offset = 0; offset < size;)
 		{
 			// Calculate size of new request
-			size_t ssize = nRequests * maxRSze + maxRSze > size ?
-				size % maxRSze :
-				maxRSze;
+			Addr saddr = addr + offset;
+			size_t ssize = std::min<size_t>(maxRSze, size - offset);
+
+			if (tlb)
+			{
+				// Consecutive virtual pages need not be contiguous in
+				// physical memory, so sub requests stop at page boundaries
+				Addr pageBytes = process->pTable->pageSize();
+				ssize = std::min<size_t>(ssize, pageBytes - saddr % pageBytes);
+			}
+
+			Tick ready = translateAccess(saddr, atomic, latency);
 
 			// Add offset to original data pointer
-			uint8_t *sdata = data + nRequests * maxRSze;
+			uint8_t *sdata = data + offset;
+			offset += ssize;
 
-			// Add sub request to pending list
-			newRequest->addSubRequest(AddrRange(saddr, saddr + ssize), sdata);
+			// Account for the new sub request
+			newRequest->addSubRequest();
 
 			PacketPtr pkt = new Packet(
-				std::make_shared<Request> (						// Create request
+				Request::create(						// Create request
 					saddr,
 					ssize,
 					0,
@@ -190,31 +505,292 @@ namespace gem5
 				ssize
 			);
 
-			// Allocate and initialize packet buffer
-			uint8_t *sdataBuffer = new uint8_t[ssize];
-			
-			if (write)
+			if (zeroCopy)
 			{
-				for (int i = 0; i < ssize; i++)
-				{
-					sdataBuffer[i] = sdata[i];
-				}
+				// Memory reads and writes the device buffer in place
+				pkt->dataStatic(sdata);
+			}
+			else
+			{
+				// Packet owns a private copy of the data
+				pkt->allocate();
+
+				if (write)
+					pkt->setData(sdata);
 			}
 
-			// Delete packet buffer when deleting packet
-			pkt->dataDynamic(sdataBuffer);
+			// Tag packet with its burst and destination buffer
+			pkt->pushSenderState(new SubRequestState(newRequest, sdata, ready));
+			stats.dmaPackets++;
+
+			issuePacket(pkt, atomic, latency);
+		}
+
+		issueBurst(newRequest, atomic, latency);
+	}
+
+	Tick
+	NDP::translateAccess(Addr &addr, bool atomic, Tick &latency)
+	{
+		Tick ready = curTick();
+
+		if (!tlb)
+			return ready;
+
+		bool miss;
+		addr = translate(addr, miss);
+
+		if (miss && atomic)
+			latency += cyclesToTicks(walkLatency);
+		else if (miss)
+		{
+			walkerFreeTick = std::max(walkerFreeTick, clockEdge()) +
+				cyclesToTicks(walkLatency);
+			ready = walkerFreeTick;
+		}
+
+		return ready;
+	}
 
+	void
+	NDP::issuePacket(PacketPtr pkt, bool atomic, Tick &latency)
+	{
+		if (atomic)
+		{
+			DPRINTF(
+				NDPMem,
+				"NDP device atomically sends %s (%p, %lu bytes)\n",
+				pkt->cmdString(),
+				pkt->getAddr(),
+				pkt->getSize()
+			);
+
+			// Sub requests are serialized in atomic mode
+			latency += dmaPort.sendAtomic(pkt);
+			completeSubRequest(pkt);
+		}
+		else
+		{
 			pendingReqPackets.push_back(pkt);
 		}
+	}
 
-		pendingRequests.push_back(newRequest);
+	void
+	NDP::issueBurst(BurstRequest *burst, bool atomic, Tick latency)
+	{
+		if (atomic)
+		{
+			// Deliver the burst once its accumulated latency has elapsed
+			schedule(
+				new EventFunctionWrapper(
+					[this, burst]
+					{
+						completeBurst(burst);
+					},
+					name() + ".atomicBurstEvent",
+					true
+				),
+				curTick() + latency
+			);
+		}
+		else
+		{
+			kickDMA();
+		}
+	}
 
-		// Trigger DMA if it is asleep
-		if (!dmaActv)
+	void
+	NDP::maintainCaches(Addr addr, size_t size, bool invalidate)
+	{
+		DPRINTF(
+			NDPMem,
+			"NDP device %s caches for %lu bytes at %p\n",
+			invalidate ? "cleaning and invalidating" : "cleaning",
+			size,
+			addr
+		);
+
+		// Nothing to maintain, not even the line addr falls in
+		if (size == 0)
+			return;
+
+		cmoPending = true;
+
+		BurstRequest *newRequest = new BurstRequest(
+			AddrRange(addr, addr + size),
+			nullptr,
+			false,
+			true
+		);
+		pendingBursts++;
+
+		bool atomic = !system->isTimingMode();
+		Tick latency = 0;
+		Addr lineBytes = system->cacheLineSize();
+
+		// Caches operate on whole lines
+		for (Addr line = addr - addr % lineBytes; line < addr + size; line += lineBytes)
 		{
-			dmaActv = true;
-			sendData();
+			Addr paddr = line;
+			Tick ready = translateAccess(paddr, atomic, latency);
+
+			newRequest->addSubRequest();
+
+			PacketPtr pkt = new Packet(
+				Request::create(
+					paddr,
+					lineBytes,
+					Request::CLEAN | Request::DST_POC |
+						(invalidate ? Request::INVALIDATE : 0),
+					0
+				),
+				invalidate ? MemCmd::CleanInvalidReq : MemCmd::CleanSharedReq
+			);
+
+			pkt->pushSenderState(new SubRequestState(newRequest, nullptr, ready));
+			stats.dmaPackets++;
+
+			issuePacket(pkt, atomic, latency);
 		}
+
+		issueBurst(newRequest, atomic, latency);
+	}
+
+	void
+	NDP::accessNearBank(Addr addr, size_t size, bool write, uint8_t *data)
+	{
+		BurstRequest *newRequest = new BurstRequest(
+			AddrRange(addr, addr + size),
+			data,
+			write
+		);
+		pendingBursts++;
+
+		PacketPtr pkt = new Packet(
+			Request::create(addr, size, 0, 0),
+			write ? MemCmd::WriteReq : MemCmd::ReadReq,
+			size
+		);
+		pkt->dataStatic(data);
+
+		// The banks stream the whole burst to their compute units at once
+		Tick ready = nearMem->nearBankAccess(pkt);
+		delete pkt;
+
+		DPRINTF(
+			NDPMem,
+			"NDP device near-bank %s %lu bytes %s %p, done in %lu ticks\n",
+			write ? "writing" : "reading",
+			size,
+			write ? "to" : "from",
+			addr,
+			ready - curTick()
+		);
+
+		schedule(
+			new EventFunctionWrapper(
+				[this, newRequest]
+				{
+					completeBurst(newRequest);
+				},
+				name() + ".nearBankEvent",
+				true
+			),
+			std::max(clockEdge(), ready)
+		);
+	}
+
+	void
+	NDP::updateOccupancy()
+	{
+		Tick elapsed = curTick() - occupancyTick;
+
+		stats.occupancy[flyReqs] += elapsed;
+		if (flyReqs > 0)
+			stats.memBusyTicks += elapsed;
+
+		occupancyTick = curTick();
+	}
+
+	void
+	NDP::addOp(const std::string &name)
+	{
+		opStats.push_back(new OpStats(*this, name));
+	}
+
+	void
+	NDP::recordOp(uint64_t op, Tick start)
+	{
+		assert(op < opStats.size());
+
+		opStats[op]->jobs++;
+		opStats[op]->latency.sample(curTick() - start);
+	}
+
+	NDP::OpStats::OpStats(NDP &ndp, const std::string &name) :
+	statistics::Group(&ndp.stats, name.c_str()),
+	ADD_STAT(jobs, statistics::units::Count::get(),
+		("Number of " + name + " jobs completed").c_str()),
+	ADD_STAT(latency, statistics::units::Tick::get(),
+		("Latency of " + name + " jobs, from start to completion").c_str())
+	{
+		latency.init(16);
+	}
+
+	NDP::NDPStats::NDPStats(NDP &ndp) :
+	statistics::Group(&ndp),
+	ndp(ndp),
+	ADD_STAT(bytesRead, statistics::units::Byte::get(),
+		"Bytes read from memory by the device"),
+	ADD_STAT(bytesWritten, statistics::units::Byte::get(),
+		"Bytes written to memory by the device"),
+	ADD_STAT(readBursts, statistics::units::Count::get(),
+		"Number of memory reads requested by the device"),
+	ADD_STAT(writeBursts, statistics::units::Count::get(),
+		"Number of memory writes requested by the device"),
+	ADD_STAT(dmaPackets, statistics::units::Count::get(),
+		"Number of packets the reads and writes were split into"),
+	ADD_STAT(dmaRetries, statistics::units::Count::get(),
+		"Number of DMA packets refused by memory and retried"),
+	ADD_STAT(burstLatency, statistics::units::Tick::get(),
+		"Latency of memory reads and writes of the device"),
+	ADD_STAT(occupancy, statistics::units::Tick::get(),
+		"Time spent with each number of DMA packets in flight"),
+	ADD_STAT(creditStallTicks, statistics::units::Tick::get(),
+		"Time the DMA engine had packets to issue but no max_reqs credits"),
+	ADD_STAT(memBusyTicks, statistics::units::Tick::get(),
+		"Time with at least one DMA packet in flight"),
+	ADD_STAT(computeBusyCycles, statistics::units::Cycle::get(),
+		"Cycles the device spent computing")
+	{
+		burstLatency.init(16);
+		occupancy.init(ndp.maxReqs + 1);
+	}
+
+	void
+	NDP::NDPStats::preDumpStats()
+	{
+		statistics::Group::preDumpStats();
+
+		// Account the time since the last change in the number of packets
+		ndp.updateOccupancy();
+	}
+
+	void
+	NDP::NDPStats::resetStats()
+	{
+		// Time before the reset belongs to no bucket of the new period
+		ndp.updateOccupancy();
+		if (ndp.creditStallTick != MaxTick)
+			ndp.creditStallTick = curTick();
+
+		statistics::Group::resetStats();
+	}
+
+	unsigned int
+	NDP::computeUnits() const
+	{
+		return nearMem ? nearMem->nearBankUnits() : 1;
 	}
 
 	bool
@@ -228,71 +804,97 @@ namespace gem5
 			pkt->getSize()
 		);
 
-		// Iterate all pending requests
-		for (auto it = pendingRequests.begin(); it != pendingRequests.end(); ++it)
+		// Return the credit of the completed packet
+		updateOccupancy();
+		flyReqs--;
+
+		if (creditStallTick != MaxTick)
 		{
-			// Pending request is the same type as pkt
-			if ((*it)->isWrite() == pkt->isWrite())
-			{
-				// Get original data pointer
-				uint8_t *dataPtr = (*it)->popPendingSubRequest(pkt->getAddrRange());
-				
-				// The subrequest belonged to this request
-				if (dataPtr)
-				{
-					// Copy data to original pointer if is read
-					if (pkt->isRead())
-					{
-						pkt->writeDataToBlock(dataPtr, pkt->getSize());
-					}
+			stats.creditStallTicks += curTick() - creditStallTick;
+			creditStallTick = MaxTick;
+		}
 
-					// Check if request is complete
-					// If so delete request and return data
-					if ((*it)->requestComplete())
-					{
-						DPRINTF(
-							NDPMem,
-							"Completed %s request (%p, %lu bytes)\n",
-							pkt->isWrite() ? "write" : "read",
-							pkt->getAddr(),
-							pkt->getSize()
-						);
-
-						recvData(
-							(*it)->getAddr(),
-							(*it)->isWrite() ? NULL : (*it)->getDataPtr(),
-							(*it)->getSize()
-						);
-
-						delete *it;
-						pendingRequests.remove(*it);
-						break;	// One subrequest belongs only to one request
-					}
-				}
-			}
+		BurstRequest *burst = completeSubRequest(pkt);
+		if (burst)
+			completeBurst(burst);
+
+		kickDMA();
+		checkDrain();
+
+		return true;
+	}
+
+	NDP::BurstRequest *
+	NDP::completeSubRequest(PacketPtr pkt)
+	{
+		// Retrieve the burst this packet belongs to
+		SubRequestState *state =
+			safe_cast<SubRequestState *>(pkt->popSenderState());
+		BurstRequest *burst = state->burst;
+
+		// Copy data to original pointer if is read
+		if (pkt->isRead() && !zeroCopy)
+		{
+			pkt->writeDataToBlock(state->dataPtr, pkt->getSize());
 		}
 
-		// Decrease the number of on-fly requests
-		flyReqs--;
+		delete state;
 
 		// Delete the packet
 		delete pkt;
 
-		// Trigger DMA if it is asleep and there are still pending packets
-		if (!dmaActv && !pendingReqPackets.empty())
+		burst->completeSubRequest();
+		return burst->requestComplete() ? burst : nullptr;
+	}
+
+	void
+	NDP::completeBurst(BurstRequest *burst)
+	{
+		pendingBursts--;
+
+		if (burst->isMaintenance())
 		{
-			dmaActv = true;
-			sendData();
+			DPRINTF(NDPMem, "Completed cache maintenance at %p\n", burst->getAddr());
+
+			cmoPending = false;
+			delete burst;
+			checkDrain();
+			return;
 		}
 
-		return true;
+		DPRINTF(
+			NDPMem,
+			"Completed %s request (%p, %lu bytes)\n",
+			burst->isWrite() ? "write" : "read",
+			burst->getAddr(),
+			burst->getSize()
+		);
+
+		stats.burstLatency.sample(curTick() - burst->getStartTick());
+
+		recvData(
+			burst->getAddr(),
+			burst->isWrite() ? NULL : burst->getDataPtr(),
+			burst->getSize()
+		);
+
+		delete burst;
+		checkDrain();
+	}
+
+	DrainState
+	NDP::drain()
+	{
+		// Bursts and jobs in flight must finish before the memory mode
+		// changes or a checkpoint is taken, as none of them is serialized
+		return idle() ? DrainState::Drained : DrainState::Draining;
 	}
 
 	bool
 	NDP::MemSidePort::recvTimingResp(PacketPtr pkt)
 	{
 		// Request was made by the CPU through mem_side
-		if (name().find("mem_side") != std::string::npos)
+		if (role == role_cpu)
 		{
 			panic_if(
 				!owner->cpuPort.sendTimingResp(pkt),
@@ -310,10 +912,11 @@ namespace gem5
 	NDP::MemSidePort::recvReqRetry()
 	{
 		// Request was made by the CPU through mem_side
-		if (name().find("mem_side") != std::string::npos)
+		if (role == role_cpu)
 			owner->cpuPort.sendRetryReq();
 		else
 		{
+			owner->dmaBlocked = false;
 			owner->sendData();
 		}
 	}
@@ -321,38 +924,36 @@ namespace gem5
 	void
 	NDP::MemSidePort::recvRangeChange()
 	{
-		owner->sendRangeChange();
+		// Only the ranges behind mem_side are visible from cpu_side
+		if (role == role_cpu)
+			owner->sendRangeChange();
 	}
 
 	AddrRangeList
 	NDP::getAddrRanges() const
 	{	
+		// Without mem_side the device is a plain MMIO device on a bus
+		if (!memPort.isConnected())
+			return AddrRangeList{ndpCtrl};
+
 		return memPort.getAddrRanges();
 	}
 
 	void
-	NDP::sendRangeChange() const
+	NDP::init()
 	{
-		cpuPort.sendRangeChange();
+		ClockedObject::init();
+
+		// Passthrough devices advertise the ranges of mem_side once it
+		// reports them, MMIO devices advertise the PI right away
+		if (cpuPort.isConnected() && !memPort.isConnected())
+			cpuPort.sendRangeChange();
 	}
-	
-	uint8_t * 
-	NDP::BurstRequest::popPendingSubRequest(AddrRange addrRange)
-	{
-		for (auto it = pendingSubRequests.begin(); it != pendingSubRequests.end(); ++it)
-		{
-			// Subrequest matches addrRange
-			if ((*it)->getAddrRange() == addrRange)
-			{
-				uint8_t *rDataPtr =
-					(*it)->getDataPtr();		// Retrieve original pointer
-				delete *it;						// Delete subrequest
-				pendingSubRequests.remove(*it);	// Remove subrequest from pending requests
-				return rDataPtr;				// Return original pointer
-			}
-		}
 
-		return NULL;
+	void
+	NDP::sendRangeChange() const
+	{
+		cpuPort.sendRangeChange();
 	}
 
 } // namespace gem5
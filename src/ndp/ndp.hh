@@ -1,7 +1,14 @@
 #ifndef __NDP_HH__
 #define __NDP_HH__
 
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "dev/intpin.hh"
 #include "mem/packet_access.hh"
+#include "ndp/ndp_tlb.hh"
 
 #include "sim/system.hh"
 #include "sim/clocked_object.hh"
@@ -14,6 +21,13 @@
 namespace gem5
 {
 
+	class Process;
+
+	namespace memory
+	{
+		class MemCtrl;
+	}
+
 	class NDP : public ClockedObject
 	{
 	private:
@@ -31,8 +45,7 @@ namespace gem5
 			AddrRangeList getAddrRanges() const override;
 
 		protected:
-			Tick recvAtomic(PacketPtr pkt) override
-			{ panic("recvAtomic unimpl."); }
+			Tick recvAtomic(PacketPtr pkt) override;
 
 			void recvFunctional(PacketPtr pkt) override;
 
@@ -43,12 +56,23 @@ namespace gem5
 
 		class MemSidePort : public RequestPort
 		{
+		public:
+			// Whether the port forwards CPU requests (mem_side) or issues
+			// the requests of the DMA engine (dma_port), fixed at creation
+			// so that responses are routed without inspecting the port
+			enum Role
+			{
+				role_cpu,
+				role_dma
+			};
+
 		private:
 			NDP *owner;
+			Role role;
 
 		public:
-			MemSidePort(const std::string& name, NDP *owner) :
-			RequestPort(name, owner), owner(owner)
+			MemSidePort(const std::string& name, NDP *owner, Role role) :
+			RequestPort(name, owner), owner(owner), role(role)
 			{ }
 
 		protected:
@@ -63,44 +87,29 @@ namespace gem5
 		{
 		private:
 
-			class SubRequest
-			{
-			private:
-
-				AddrRange addrRange;
-				uint8_t *dataPtr;
-
-			public:
-
-				SubRequest(AddrRange addrRange, uint8_t *dataPtr) :
-				addrRange(addrRange), dataPtr(dataPtr)
-				{ }
-
-				AddrRange getAddrRange()
-				{ return addrRange; };
-
-				uint8_t *getDataPtr()
-				{ return dataPtr; };
-			};
-
 			AddrRange addrRange;
 			uint8_t *dataPtr;
 			bool writeRequest;
-			std::list<SubRequest *> pendingSubRequests;
+			uint64_t pendingSubRequests;
+			Tick startTick;
+			bool maintenance;
 
 		public:
 
-			BurstRequest(AddrRange addrRange, uint8_t *dataPtr, bool writeRequest) :
-			addrRange(addrRange), dataPtr(dataPtr), writeRequest(writeRequest)
+			BurstRequest(AddrRange addrRange, uint8_t *dataPtr, bool writeRequest,
+				bool maintenance = false) :
+			addrRange(addrRange), dataPtr(dataPtr), writeRequest(writeRequest),
+			pendingSubRequests(0), startTick(curTick()), maintenance(maintenance)
 			{ }
 
-			void addSubRequest(AddrRange addrRange, uint8_t *dataPtr)
-			{ pendingSubRequests.push_back(new SubRequest(addrRange, dataPtr)); };
-			
-			uint8_t *popPendingSubRequest(AddrRange addrRange);
-			
+			void addSubRequest()
+			{ pendingSubRequests++; };
+
+			void completeSubRequest()
+			{ assert(pendingSubRequests > 0); pendingSubRequests--; };
+
 			bool requestComplete()
-			{ return pendingSubRequests.empty(); };
+			{ return pendingSubRequests == 0; };
 
 			Addr getAddr()
 			{ return addrRange.start(); };
@@ -115,24 +124,187 @@ namespace gem5
 			{ return writeRequest; };
 
 			int countPendingSubRequests()
-			{ return pendingSubRequests.size(); }
+			{ return pendingSubRequests; }
+
+			Tick getStartTick()
+			{ return startTick; };
+
+			bool isMaintenance()
+			{ return maintenance; };
+		};
+
+		// Tags every DMA packet with the burst it belongs to, so that a
+		// response is matched to its request without searching
+		struct SubRequestState : public Packet::SenderState
+		{
+			BurstRequest *burst;
+			uint8_t *dataPtr;
+			Tick readyTick;		// Translation of the packet is available
+
+			SubRequestState(BurstRequest *burst, uint8_t *dataPtr, Tick readyTick) :
+			burst(burst), dataPtr(dataPtr), readyTick(readyTick)
+			{ }
 		};
 
 		AddrRangeList getAddrRanges() const;
 
 		void sendRangeChange() const;
 
+		// A PI access may span several registers (e.g., a whole job
+		// descriptor written by one wide store), which are accessed
+		// in ascending order. Functional accesses only see and set the
+		// values of registers, they never start anything.
+		void accessPI(PacketPtr pkt, bool functional = false);
+
+		bool readBaseReg(uint64_t ridx, uint64_t &data);
+
+		uint64_t readReg(uint64_t ridx);
+
+		void writeReg(uint64_t ridx, uint64_t data);
+
+		uint64_t peekReg(uint64_t ridx);
+
+		void pokeReg(uint64_t ridx, uint64_t data);
+
 		bool handleRequest(PacketPtr pkt);
 
 		bool memCallback(PacketPtr pkt);
 
+		BurstRequest *completeSubRequest(PacketPtr pkt);
+
+		void completeBurst(BurstRequest *burst);
+
+		bool dmaIdle() const
+		{ return pendingReqPackets.empty() && flyReqs == 0; }
+
+		// Bursts that did not complete yet, whichever path carries them
+		// (timing DMA, atomic latency events or near-bank events)
+		uint64_t pendingBursts;
+
+		bool idle() const
+		{ return dmaIdle() && pendingBursts == 0 && !busy(); }
+
+		void kickDMA();
+
 		CPUSidePort cpuPort;
 		MemSidePort memPort, dmaPort;
 		AddrRange ndpCtrl, ndpData;
-		bool dmaActv;
 		uint64_t maxRSze, maxReqs, flyReqs;
-		std::list<BurstRequest *> pendingRequests;
-		std::list<PacketPtr> pendingReqPackets, pendingRespPackets;
+		std::deque<PacketPtr> pendingReqPackets;
+
+		// DMA engine issuing up to dmaWidth packets per cycle while holding
+		// at most maxReqs in-flight packets (one credit per packet)
+		EventFunctionWrapper dmaEvent;
+		uint64_t dmaWidth, dmaIssued;
+		Tick dmaIssueTick;
+		bool dmaBlocked;
+
+		// DMA packets point straight at the buffer given to accessMemory,
+		// which must then stay untouched until the burst completes
+		bool zeroCopy;
+
+		System *system;
+
+		// Completion interrupt, controlled through the last two registers
+		// of the PI: interrupt enable and interrupt status (write to ack)
+		std::vector<IntSourcePin<NDP> *> intPin;
+		bool intEnabled, intPending;
+
+		uint64_t intEnableReg() const
+		{ return ndpCtrl.size() / sizeof(uint64_t) - 2; }
+
+		uint64_t intStatusReg() const
+		{ return ndpCtrl.size() / sizeof(uint64_t) - 1; }
+
+		void updateInterrupt(bool wasRaised);
+
+		// Optional device TLB: DMA addresses are virtual addresses of
+		// process, translated by walking its page table on a miss. Walks
+		// are serialized in a single walker that is busy until walkerFreeTick.
+		// Writing the register below the interrupt ones flushes the TLB.
+		NDPTLB *tlb;
+		Cycles walkLatency;
+		Process *process;
+		Tick walkerFreeTick;
+
+		uint64_t tlbFlushReg() const
+		{ return ndpCtrl.size() / sizeof(uint64_t) - 3; }
+
+		Addr translate(Addr vaddr, bool &miss);
+
+		// Near-bank placement: operands are accessed by compute units next
+		// to the DRAM banks of nearMem instead of through dma_port, at the
+		// internal bandwidth of the banks. The PI stays on cpu_side.
+		memory::MemCtrl *nearMem;
+
+		void accessNearBank(Addr addr, size_t size, bool write, uint8_t *data);
+
+		Tick translateAccess(Addr &addr, bool atomic, Tick &latency);
+
+		void issuePacket(PacketPtr pkt, bool atomic, Tick &latency);
+
+		void issueBurst(BurstRequest *burst, bool atomic, Tick latency);
+
+		// Cache maintenance of a range, issued through dma_port as one clean
+		// (and invalidate) request per cache line down to the point of
+		// coherence. The host starts it with the three registers below the
+		// TLB flush one: address, size, and command (1 clean, 2 clean and
+		// invalidate), which reads 1 once the maintenance completed.
+		Addr cmoAddr;
+		uint64_t cmoSize;
+		bool cmoPending;
+
+		uint64_t cmoAddrReg() const
+		{ return ndpCtrl.size() / sizeof(uint64_t) - 6; }
+
+		uint64_t cmoSizeReg() const
+		{ return ndpCtrl.size() / sizeof(uint64_t) - 5; }
+
+		uint64_t cmoCmdReg() const
+		{ return ndpCtrl.size() / sizeof(uint64_t) - 4; }
+
+		void maintainCaches(Addr addr, size_t size, bool invalidate);
+
+		// Accounts the time spent with the current number of in-flight
+		// requests, called before flyReqs changes
+		void updateOccupancy();
+
+		Tick occupancyTick;
+		Tick creditStallTick;	// Start of a stall on max_reqs, MaxTick if none
+
+		// Statistics of the jobs of one operation of the device
+		struct OpStats : public statistics::Group
+		{
+			OpStats(NDP &ndp, const std::string &name);
+
+			statistics::Scalar jobs;
+			statistics::Histogram latency;
+		};
+
+		struct NDPStats : public statistics::Group
+		{
+			NDPStats(NDP &ndp);
+
+			void preDumpStats() override;
+
+			void resetStats() override;
+
+			NDP &ndp;
+
+			statistics::Scalar bytesRead;
+			statistics::Scalar bytesWritten;
+			statistics::Scalar readBursts;
+			statistics::Scalar writeBursts;
+			statistics::Scalar dmaPackets;
+			statistics::Scalar dmaRetries;
+			statistics::Histogram burstLatency;
+			statistics::Vector occupancy;
+			statistics::Scalar creditStallTicks;
+			statistics::Scalar memBusyTicks;
+			statistics::Scalar computeBusyCycles;
+		} stats;
+
+		std::vector<OpStats *> opStats;
 
 	protected:
 
@@ -142,8 +314,39 @@ namespace gem5
 		virtual void writePI(uint64_t ridx, uint64_t data)
 		{ panic("writePI must be implemented in subclass of NDP."); };
 
+		// Functional counterparts of readPI and writePI: they return
+		// false for registers that hold no value (e.g., the ones that
+		// start a job), which read as 0 and ignore writes
+		virtual bool peekPI(uint64_t ridx, uint64_t &data)
+		{ return false; };
+
+		virtual bool pokePI(uint64_t ridx, uint64_t data)
+		{ return false; };
+
 		void accessMemory(Addr addr, size_t size, bool write, uint8_t *data);
 
+		void notifyCompletion();
+
+		// Whether the device has work in flight other than memory bursts
+		// (e.g., jobs computing). Subclasses call notifyCompletion() or
+		// checkDrain() once it finishes, so that a drain can complete.
+		virtual bool busy() const
+		{ return false; };
+
+		void checkDrain();
+
+		// Number of compute units that work on the operands in parallel
+		unsigned int computeUnits() const;
+
+		// Registers the statistics of the next operation code of the device
+		void addOp(const std::string &name);
+
+		// Accounts a job of operation op that started at start
+		void recordOp(uint64_t op, Tick start);
+
+		void recordCompute(Cycles cycles)
+		{ stats.computeBusyCycles += cycles; };
+
 		virtual void recvData(Addr addr, uint8_t *data, size_t size)
 		{ panic("recvData must be implemented in subclass of NDP."); };
 
@@ -154,6 +357,10 @@ namespace gem5
 		Port &getPort(const std::string &if_name,
 			PortID idx=InvalidPortID) override;
 
+		void init() override;
+
+		DrainState drain() override;
+
 		void sendData();
 
 	};
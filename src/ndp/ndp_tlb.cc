@@ -0,0 +1,55 @@
+#include "ndp/ndp_tlb.hh"
+
+#include <cassert>
+
+namespace gem5
+{
+	NDPTLB::NDPTLB(size_t numEntries) :
+	numEntries(numEntries)
+	{
+		assert(numEntries > 0);
+	}
+
+	bool
+	NDPTLB::lookup(Addr vpage, Addr &ppage)
+	{
+		auto it = index.find(vpage);
+		if (it == index.end())
+			return false;
+
+		// Move the entry to the MRU position
+		entries.splice(entries.begin(), entries, it->second);
+		ppage = it->second->second;
+
+		return true;
+	}
+
+	void
+	NDPTLB::insert(Addr vpage, Addr ppage)
+	{
+		auto it = index.find(vpage);
+		if (it != index.end())
+		{
+			it->second->second = ppage;
+			entries.splice(entries.begin(), entries, it->second);
+			return;
+		}
+
+		if (entries.size() == numEntries)
+		{
+			index.erase(entries.back().first);
+			entries.pop_back();
+		}
+
+		entries.emplace_front(vpage, ppage);
+		index[vpage] = entries.begin();
+	}
+
+	void
+	NDPTLB::flush()
+	{
+		entries.clear();
+		index.clear();
+	}
+
+} // namespace gem5
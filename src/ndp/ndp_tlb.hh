@@ -0,0 +1,44 @@
+#ifndef __NDP_TLB_HH__
+#define __NDP_TLB_HH__
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include "base/types.hh"
+
+namespace gem5
+{
+
+	// Fully-associative device TLB with LRU replacement. It caches
+	// translations from virtual to physical page addresses for the DMA
+	// engine of an NDP device, in the spirit of a PCIe ATS cache.
+	class NDPTLB
+	{
+	private:
+
+		size_t numEntries;
+
+		// Most recently used translation at the front
+		std::list<std::pair<Addr, Addr>> entries;
+		std::unordered_map<Addr, std::list<std::pair<Addr, Addr>>::iterator> index;
+
+	public:
+
+		NDPTLB(size_t numEntries);
+
+		// Returns true and the physical page of vpage on a hit
+		bool lookup(Addr vpage, Addr &ppage);
+
+		// Caches a translation, evicting the least recently used one
+		void insert(Addr vpage, Addr ppage);
+
+		void flush();
+
+		size_t size() const
+		{ return entries.size(); }
+	};
+
+} // namespace gem5
+
+#endif // __NDP_TLB_HH__
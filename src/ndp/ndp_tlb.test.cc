@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include "ndp/ndp_tlb.hh"
+
+using namespace gem5;
+
+TEST(NDPTLBTest, HitAndMiss)
+{
+	NDPTLB tlb(4);
+	Addr ppage = 0;
+
+	EXPECT_FALSE(tlb.lookup(0x1000, ppage));
+
+	tlb.insert(0x1000, 0x80000);
+	EXPECT_TRUE(tlb.lookup(0x1000, ppage));
+	EXPECT_EQ(0x80000, ppage);
+	EXPECT_FALSE(tlb.lookup(0x2000, ppage));
+
+	// Re-inserting a page updates its translation in place
+	tlb.insert(0x1000, 0x90000);
+	EXPECT_TRUE(tlb.lookup(0x1000, ppage));
+	EXPECT_EQ(0x90000, ppage);
+	EXPECT_EQ(1, tlb.size());
+}
+
+// The least recently used translation is the one evicted
+TEST(NDPTLBTest, LRUReplacement)
+{
+	NDPTLB tlb(2);
+	Addr ppage = 0;
+
+	tlb.insert(0x1000, 0x10000);
+	tlb.insert(0x2000, 0x20000);
+
+	// Touch the oldest entry so that 0x2000 becomes the LRU one
+	EXPECT_TRUE(tlb.lookup(0x1000, ppage));
+
+	tlb.insert(0x3000, 0x30000);
+	EXPECT_EQ(2, tlb.size());
+	EXPECT_TRUE(tlb.lookup(0x1000, ppage));
+	EXPECT_FALSE(tlb.lookup(0x2000, ppage));
+	EXPECT_TRUE(tlb.lookup(0x3000, ppage));
+	EXPECT_EQ(0x30000, ppage);
+}
+
+TEST(NDPTLBTest, Flush)
+{
+	NDPTLB tlb(2);
+	Addr ppage = 0;
+
+	tlb.insert(0x1000, 0x10000);
+	tlb.flush();
+
+	EXPECT_EQ(0, tlb.size());
+	EXPECT_FALSE(tlb.lookup(0x1000, ppage));
+}
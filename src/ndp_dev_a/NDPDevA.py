@@ -5,4 +5,17 @@ from m5.objects.NDP import NDP
 class NDPDevA(NDP):
 	type = 'NDPDevA'
 	cxx_header = "ndp_dev_a/ndp_dev_a.hh"
-	cxx_class = 'gem5::NDPDevA'
\ No newline at end of file
+	cxx_class = 'gem5::NDPDevA'
+
+	max_jobs = Param.Unsigned(2, "Maximum number of jobs fetched ahead of and including the one computing")
+	stream_chunk = Param.Unsigned(0, "Bytes of operands fetched and computed per step, 0 to wait for whole arrays")
+	stream_buffers = Param.Unsigned(2, "Number of operand chunks of a job buffered in streaming mode")
+	simd_width = Param.Unsigned(8, "Bytes of operands the compute lanes process per cycle (one lane per element)")
+
+class NDPDevADispatcher(NDP):
+	type = 'NDPDevADispatcher'
+	cxx_header = "ndp_dev_a/ndp_dev_a_dispatcher.hh"
+	cxx_class = 'gem5::NDPDevADispatcher'
+
+	shards = VectorParam.NDPDevA("NDPDevA instances the jobs are scattered to, e.g., one per memory channel")
+	shard_ranges = VectorParam.AddrRange("Address range (usually an interleaved memory channel) each shard processes")
@@ -1,11 +1,50 @@
 #include "ndp_dev_a/ndp_dev_a.hh"
 
+#include <algorithm>
+#include <cstring>
+
+#include "base/intmath.hh"
+
 namespace gem5
 {
 	NDPDevA::NDPDevA(const NDPDevAParams &params) :
-	NDP(params)
+	NDP(params),
+	maxJobs(params.max_jobs),
+	streamChunk(params.stream_chunk),
+	streamBuffers(params.stream_buffers),
+	simdWidth(params.simd_width),
+	computeEvent([this] { finishCompute(); }, name() + ".computeEvent")
+	{
+		fatal_if(maxJobs == 0, "NDPDevA max_jobs must be at least 1.\n");
+		fatal_if(
+			params.stream_chunk % sizeof(uint64_t),
+			"NDPDevA stream_chunk must be a multiple of %lu bytes.\n",
+			sizeof(uint64_t)
+		);
+		fatal_if(streamBuffers == 0, "NDPDevA stream_buffers must be at least 1.\n");
+		fatal_if(simdWidth == 0, "NDPDevA simd_width must be at least 1.\n");
+
+		// Statistics of every operation
+		for (uint64_t op = 0; op < num_ops; op++)
+			addOp(opName(op));
+	}
+
+	const char *
+	NDPDevA::opName(uint64_t op)
 	{
+		static const char *names[num_ops] = {
+			"compareHit",
+			"compareCount",
+			"compareMax",
+			"sum",
+			"min",
+			"avg",
+			"filter",
+			"histogram",
+			"topK"
+		};
 
+		return names[op];
 	}
 
 	uint64_t 
@@ -19,6 +58,11 @@ namespace gem5
 	    case 6: 
 	    	// DPRINTF(NDPDevAPI, "NDP device PI: r[%lu] = %lu\n", ridx, pi_last_rslt);
 	    	return pi_last_rslt;
+	    case 7: return pi_ring_base;
+	    case 8: return pi_ring_size;
+	    case 9: return pi_ring_head;
+	    case 10: return pi_ring_tail;
+	    case 11: return pi_addr_outp;
 	    default:
 	    	panic("NDPDevA does not have readable r[%lu] register!\n", ridx);
 		}
@@ -29,7 +73,7 @@ namespace gem5
 	{
 		DPRINTF(NDPDevAPI, "NDP device PI: %lu -> r[%lu]\n", data, ridx);
 
-		if (!pi_stat_rgst)
+		if ((ridx <= 4 || ridx == 11) && !pi_stat_rgst)
 		{
 			panic("Tried to started workload when previous one is not finished!\n");
 		}
@@ -41,6 +85,7 @@ namespace gem5
 	    case 2: pi_data_skey = data; break;
 	    case 3: pi_cmmd_code = data; break;
 	    case 4:
+	    {
     		DPRINTF(
     			NDPDevAPI,
     			"NDPDevA started processing...\n"
@@ -58,128 +103,638 @@ namespace gem5
 	    		pi_last_rslt
     		);
     		pi_stat_rgst = 0;
-    		scaleFactor = data;
-    		process_fsm();
+
+    		// Jobs started through the PI bypass the command ring
+    		Job *job = new Job;
+    		job->desc[desc_addr_data] = pi_addr_data;
+    		job->desc[desc_data_size] = pi_data_size;
+    		job->desc[desc_data_skey] = pi_data_skey;
+    		job->desc[desc_cmmd_code] = pi_cmmd_code;
+    		job->desc[desc_scale] = data;
+    		job->desc[desc_addr_outp] = pi_addr_outp;
+    		jobs.push_back(job);
+    		residentJobs++;
+
+    		startJob(job);
+	    	break;
+	    }
+	    case 7:
+	    case 8:
+	    	panic_if(
+	    		pi_ring_head != pi_ring_tail,
+	    		"Tried to move the command ring while it has pending jobs!\n"
+	    	);
+	    	if (ridx == 7)
+	    		pi_ring_base = data;
+	    	else
+	    		pi_ring_size = data;
+	    	break;
+	    case 9:
+	    	// Doorbell: the host published jobs up to (excluding) data
+	    	panic_if(
+	    		data - pi_ring_tail > pi_ring_size,
+	    		"Command ring overflow (head %lu, tail %lu, size %lu)!\n",
+	    		data, pi_ring_tail, pi_ring_size
+	    	);
+	    	pi_ring_head = data;
+	    	fetchJobs();
 	    	break;
+	    case 11: pi_addr_outp = data; break;
 	    default:
 	    	panic("NDPDevA does not have writable r[%lu] register!\n", ridx);
 		}
 	}
 
+	bool
+	NDPDevA::peekPI(uint64_t ridx, uint64_t &data)
+	{
+		switch (ridx)
+		{
+		case 0: data = pi_addr_data; return true;
+		case 1: data = pi_data_size; return true;
+		case 2: data = pi_data_skey; return true;
+		case 3: data = pi_cmmd_code; return true;
+		case 5: case 6: case 7: case 8: case 9: case 10: case 11:
+			data = readPI(ridx);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool
+	NDPDevA::pokePI(uint64_t ridx, uint64_t data)
+	{
+		switch (ridx)
+		{
+		case 0: pi_addr_data = data; return true;
+		case 1: pi_data_size = data; return true;
+		case 2: pi_data_skey = data; return true;
+		case 3: pi_cmmd_code = data; return true;
+		case 7:
+		case 8:
+			// The ring cannot move under the jobs it still holds
+			if (pi_ring_head != pi_ring_tail)
+				return false;
+			if (ridx == 7)
+				pi_ring_base = data;
+			else
+				pi_ring_size = data;
+			return true;
+		case 11: pi_addr_outp = data; return true;
+		default:
+			// The start and doorbell registers only act in timing
+			return false;
+		}
+	}
+
 	void 
 	NDPDevA::recvData(Addr addr, uint8_t *data, size_t size)
 	{
 		DPRINTF(NDPDevAMem, "NDPDevA received %u bytes from %p\n", size, addr);
 
-		has_operands = true;
+		for (Job *job : jobs)
+		{
+			if (job->state == job_fetch_desc && data == (uint8_t *) job->desc)
+			{
+				startJob(job);
+				return;
+			}
+			else if (job->state == job_write_back && !data &&
+				addr == job->descAddr + desc_result * sizeof(uint64_t))
+			{
+				recordOp(job->op, job->startTick);
+				job->state = job_done;
+				retireJobs();
+				notifyCompletion();
+				return;
+			}
+			else if (!data && job->outputs.count(addr))
+			{
+				delete[] job->outputs[addr];
+				job->outputs.erase(addr);
+
+				// The job is visible once all its outputs are in memory
+				if (job->state == job_write_out && job->outputs.empty())
+					publishJob(job);
+				return;
+			}
 
-		process_fsm();
+			for (Chunk *chunk : job->chunks)
+			{
+				if (data == (uint8_t *) chunk->data)
+				{
+					chunk->loaded = true;
+					tryCompute();
+					return;
+				}
+			}
+		}
+
+		for (auto it = discardedChunks.begin(); it != discardedChunks.end(); ++it)
+		{
+			if (data == (uint8_t *) (*it)->data)
+			{
+				delete *it;
+				discardedChunks.erase(it);
+				return;
+			}
+		}
+
+		panic("NDPDevA received data that belongs to no job!\n");
+	}
+
+	bool
+	NDPDevA::matches(uint64_t pred, uint64_t value, uint64_t key)
+	{
+		switch (pred)
+		{
+		case pred_eq: return value == key;
+		case pred_ne: return value != key;
+		case pred_lt: return value < key;
+		case pred_le: return value <= key;
+		case pred_gt: return value > key;
+		default: return value >= key;
+		}
 	}
 
+	template <typename T>
 	uint64_t
-	NDPDevA::compare_n_hit(uint64_t *data, uint64_t size, uint64_t skey)
+	NDPDevA::computeChunk(Job *job, const T *data, uint64_t size)
 	{
-	    for (int i = 0; i < size; ++i)
-	    {
-	        if (data[i] == skey)
-	        {
-	            pi_last_rslt = 1;
+		uint64_t &result = job->desc[desc_result];
+		uint64_t pred = cmdPred(job->desc[desc_cmmd_code]);
+		uint64_t key = job->desc[desc_data_skey];
 
-	            return i;
-	        }
-	    }
+		switch (job->op)
+		{
+		case op_hit:
+			for (uint64_t i = 0; i < size; ++i)
+			{
+				if (matches(pred, data[i], key))
+				{
+					result = 1;
+					job->stop = true;
+
+					return i;
+				}
+			}
+			break;
+		case op_count:
+			for (uint64_t i = 0; i < size; ++i)
+				result += matches(pred, data[i], key);
+			break;
+		case op_max:
+			for (uint64_t i = 0; i < size; ++i)
+				result = std::max<uint64_t>(result, data[i]);
+			break;
+		case op_sum:
+		case op_avg:
+			for (uint64_t i = 0; i < size; ++i)
+				result += data[i];
+			break;
+		case op_min:
+			for (uint64_t i = 0; i < size; ++i)
+				result = std::min<uint64_t>(result, data[i]);
+			break;
+		case op_filter:
+		{
+			// Written back once the chunk finishes computing
+			job->chunkOut.resize(size * sizeof(T));
+			T *out = (T *) job->chunkOut.data();
+			uint64_t kept = 0;
+
+			for (uint64_t i = 0; i < size; ++i)
+			{
+				if (matches(pred, data[i], key))
+					out[kept++] = data[i];
+			}
 
-	    return size;
+			job->chunkOut.resize(kept * sizeof(T));
+			result += kept;
+			break;
+		}
+		case op_histogram:
+		{
+			// Elements past the last bucket count in the last one
+			uint64_t width = std::max<uint64_t>(key, 1);
+			for (uint64_t i = 0; i < size; ++i)
+				job->acc[std::min<uint64_t>(data[i] / width, job->acc.size() - 1)]++;
+			result += size;
+			break;
+		}
+		case op_topk:
+		{
+			// acc is a min-heap of the k largest elements seen so far
+			uint64_t k = cmdParam(job->desc[desc_cmmd_code]);
+			auto cmp = std::greater<uint64_t>();
+			for (uint64_t i = 0; i < size; ++i)
+			{
+				if (job->acc.size() < k)
+				{
+					job->acc.push_back(data[i]);
+					std::push_heap(job->acc.begin(), job->acc.end(), cmp);
+				}
+				else if (data[i] > job->acc.front())
+				{
+					std::pop_heap(job->acc.begin(), job->acc.end(), cmp);
+					job->acc.back() = data[i];
+					std::push_heap(job->acc.begin(), job->acc.end(), cmp);
+				}
+			}
+			break;
+		}
+		}
+
+		return size;
 	}
 
-	uint64_t
-	NDPDevA::compare_n_count(uint64_t *data, uint64_t size, uint64_t skey)
+	Cycles
+	NDPDevA::computeCycles(Job *job, uint64_t inspected)
 	{
-	    uint64_t n = 0;
+		// Each cycle the lanes take simd_width bytes of elements, then a
+		// reduction tree (a prefix sum for filter) combines their partial
+		// results. For top-k every lane inserts into a heap of k elements.
+		uint64_t lanes = std::max<uint64_t>(1, simdWidth / job->elemSize);
+		uint64_t steps = divCeil(inspected, lanes);
 
-	    for (int i = 0; i < size; ++i)
-	    {
-	        if (data[i] == skey)
-	        {
-	            n++;
-	        }
-	    }
+		if (job->op == op_topk)
+			steps *= ceilLog2(cmdParam(job->desc[desc_cmmd_code]) + 1);
+
+		uint64_t cycles = steps + (inspected ? ceilLog2(lanes) : 0);
 
-	    pi_last_rslt = n;
-	    
-	    return size;
+		// Near-bank units split the chunk, each scanning its own banks
+		return Cycles(divCeil(cycles, computeUnits()) * job->desc[desc_scale]);
 	}
 
-	uint64_t
-	NDPDevA::compare_n_max(uint64_t *data, uint64_t size)
+	void
+	NDPDevA::fetchJobs()
 	{
-	    uint64_t max = data[0];
-	    for (int i = 1; i < size; ++i)
-	    {
-	        if (data[i] > max)
-	        {
-	            max = data[i];
-	        }
-	    }
+		// Prefetch descriptors while there is room in the device
+		while (fetchIdx != pi_ring_head && residentJobs < maxJobs)
+		{
+			Job *job = new Job;
+			job->ring = true;
+			job->descAddr = pi_ring_base +
+				(fetchIdx % pi_ring_size) * desc_words * sizeof(uint64_t);
+			jobs.push_back(job);
+			residentJobs++;
+			fetchIdx++;
+
+			DPRINTF(
+				NDPDevA,
+				"Retrieving job descriptor from %p\n",
+				job->descAddr
+			);
+			accessMemory(
+				job->descAddr,
+				desc_words * sizeof(uint64_t),
+				false,
+				(uint8_t *) job->desc
+			);
+		}
+	}
+
+	void
+	NDPDevA::submitShard(
+		Addr addr,
+		uint64_t size,
+		uint64_t skey,
+		uint64_t cmd,
+		uint64_t scale,
+		AddrRange range,
+		std::function<void(uint64_t)> done)
+	{
+		DPRINTF(
+			NDPDevA,
+			"NDPDevA received shard %s of %lu elements from %p\n",
+			range.to_string(),
+			size,
+			addr
+		);
+
+		Job *job = new Job;
+		job->desc[desc_addr_data] = addr;
+		job->desc[desc_data_size] = size;
+		job->desc[desc_data_skey] = skey;
+		job->desc[desc_cmmd_code] = cmd;
+		job->desc[desc_scale] = scale;
+		job->range = range;
+		job->onDone = done;
+		jobs.push_back(job);
+		residentJobs++;
+
+		startJob(job);
+	}
+
+	void
+	NDPDevA::startJob(Job *job)
+	{
+		uint64_t cmd = job->desc[desc_cmmd_code];
 
-	    pi_last_rslt = max;
+		job->op = cmdOp(cmd);
+		job->elemSize = cmdElemSize(cmd);
+		job->chunkElems = streamChunk ?
+			std::max<uint64_t>(1, streamChunk / job->elemSize) :
+			job->desc[desc_data_size];
 
-	    return size;
+		panic_if(job->op >= num_ops, "Invalid command was issued to NDPDevA!\n");
+		panic_if(cmdPred(cmd) >= num_preds, "Invalid predicate was issued to NDPDevA!\n");
+		panic_if(
+			(job->op == op_histogram || job->op == op_topk) && !cmdParam(cmd),
+			"NDPDevA %s needs at least one output element!\n",
+			opName(job->op)
+		);
+		panic_if(
+			job->fromShard() && !reducible(job->op),
+			"NDPDevA %s cannot run on shards!\n",
+			opName(job->op)
+		);
+
+		// Ring descriptors are fetched whole, the device owns these words
+		job->desc[desc_result] = job->op == op_min ? mask(job->elemSize * 8) : 0;
+		job->desc[desc_status] = 0;
+
+		if (job->op == op_histogram)
+			job->acc.assign(cmdParam(cmd), 0);
+
+		fetchOperands(job);
+	}
+
+	uint64_t
+	NDPDevA::shardRun(const AddrRange &range, Addr addr)
+	{
+		// Bytes from addr on that are all inside or all outside range
+		if (range.interleaved())
+			return range.granularity() - addr % range.granularity();
+		else if (addr < range.start())
+			return range.start() - addr;
+		else if (range.contains(addr))
+			return range.end() - addr;
+		else
+			return MaxAddr;
 	}
 
 	void
-	NDPDevA::process_fsm()
+	NDPDevA::fetchOperands(Job *job)
 	{
-		// Retrive operands from memory
-		if (!has_operands)
+		uint64_t size = job->desc[desc_data_size];
+
+		job->state = job_stream_data;
+
+		// Keep up to streamBuffers chunks of the job requested
+		while (job->nextElem < size && job->chunks.size() < streamBuffers)
 		{
+			Addr addr = job->desc[desc_addr_data] + job->nextElem * job->elemSize;
+			uint64_t elems = std::max<uint64_t>(1, std::min({
+				job->chunkElems,
+				size - job->nextElem,
+				shardRun(job->range, addr) / job->elemSize
+			}));
+
+			// Elements of other shards count as done without being fetched
+			if (!job->range.contains(addr))
+			{
+				job->nextElem += elems;
+				job->doneElems += elems;
+				continue;
+			}
+
+			Chunk *chunk = new Chunk(elems, job->elemSize);
+			job->chunks.push_back(chunk);
+			job->nextElem += chunk->size;
+
 			DPRINTF(
 				NDPDevA,
 				"Retrieving operads from memory: %lu bytes from %p\n",
-				pi_data_size * sizeof(uint64_t),
-				pi_addr_data
+				chunk->size * job->elemSize,
+				addr
 			);
-			operands = new uint64_t[pi_data_size];
 			accessMemory(
-				Addr(pi_addr_data),
-				pi_data_size * sizeof(uint64_t),
+				addr,
+				chunk->size * job->elemSize,
 				false,
-				(uint8_t *) operands
+				chunk->data
 			);
 		}
-		else
-		{
-			uint64_t cycles;
 
-			switch (pi_cmmd_code)
+		// Nothing to retrieve, the job may complete right away
+		if (job->chunks.empty())
+			tryCompute();
+	}
+
+	void
+	NDPDevA::tryCompute()
+	{
+		if (computingJob)
+			return;
+
+		// Jobs compute in submission order
+		Job *job = nullptr;
+		for (Job *candidate : jobs)
+		{
+			if (candidate->state < job_write_out)
 			{
-			case 0: 
-				cycles = compare_n_hit(operands, pi_data_size, pi_data_skey);
+				job = candidate;
 				break;
+			}
+		}
+
+		if (!job || job->state != job_stream_data)
+			return;
+
+		uint64_t inspected = 0;
+
+		if (job->doneElems < job->desc[desc_data_size])
+		{
+			// Wait for the oldest chunk of the job to arrive
+			Chunk *chunk = job->chunks.front();
+			if (!chunk->loaded)
+				return;
+
+			switch (job->elemSize)
+			{
 			case 1:
-				cycles = compare_n_count(operands, pi_data_size, pi_data_skey);
+				inspected = computeChunk(job, (uint8_t *) chunk->data, chunk->size);
 				break;
 			case 2:
-				cycles = compare_n_max(operands, pi_data_size);
+				inspected = computeChunk(job, (uint16_t *) chunk->data, chunk->size);
+				break;
+			case 4:
+				inspected = computeChunk(job, (uint32_t *) chunk->data, chunk->size);
 				break;
 			default:
-				panic("Invalid command was issued to NDPDevA!\n");
+				inspected = computeChunk(job, (uint64_t *) chunk->data, chunk->size);
+				break;
+			}
+		}
+
+		computingJob = job;
+
+		Cycles cycles = computeCycles(job, inspected);
+		recordCompute(cycles);
+
+		// Later chunks and jobs keep streaming in while this chunk computes
+		schedule(computeEvent, clockEdge(cycles));
+	}
+
+	void
+	NDPDevA::finishCompute()
+	{
+		Job *job = computingJob;
+		computingJob = nullptr;
+
+		if (!job->chunks.empty())
+		{
+			Chunk *chunk = job->chunks.front();
+			job->chunks.pop_front();
+			job->doneElems += chunk->size;
+			delete chunk;
+		}
+
+		// Compacted elements go right after those of the previous chunks
+		if (!job->chunkOut.empty())
+		{
+			writeOutput(
+				job,
+				job->desc[desc_addr_outp] + job->outElems * job->elemSize,
+				job->chunkOut.data(),
+				job->chunkOut.size()
+			);
+			job->outElems += job->chunkOut.size() / job->elemSize;
+			job->chunkOut.clear();
+		}
+
+		if (job->stop || job->doneElems == job->desc[desc_data_size])
+			finishJob(job);
+		else
+			fetchOperands(job);
+
+		fetchJobs();
+		tryCompute();
+	}
+
+	void
+	NDPDevA::writeOutput(Job *job, Addr addr, const void *data, size_t size)
+	{
+		uint8_t *buffer = new uint8_t[size];
+		std::memcpy(buffer, data, size);
+		job->outputs[addr] = buffer;
+
+		DPRINTF(NDPDevA, "Writing %lu bytes of output to %p\n", size, addr);
+		accessMemory(addr, size, true, buffer);
+	}
+
+	void
+	NDPDevA::finishJob(Job *job)
+	{
+		residentJobs--;
+
+		// Drop the chunks the job no longer needs
+		for (Chunk *chunk : job->chunks)
+		{
+			if (chunk->loaded)
+				delete chunk;
+			else
+				discardedChunks.push_back(chunk);
+		}
+		job->chunks.clear();
+
+		uint64_t &result = job->desc[desc_result];
+		uint64_t size = job->desc[desc_data_size];
+
+		switch (job->op)
+		{
+		case op_avg:
+			// The dispatcher divides the sum of all shards itself
+			if (!job->fromShard())
+				result = size ? result / size : 0;
+			break;
+		case op_histogram:
+			writeOutput(
+				job,
+				job->desc[desc_addr_outp],
+				job->acc.data(),
+				job->acc.size() * sizeof(uint64_t)
+			);
+			break;
+		case op_topk:
+			// Sorting the min-heap leaves the largest elements first
+			std::sort_heap(job->acc.begin(), job->acc.end(), std::greater<uint64_t>());
+			result = job->acc.size();
+			if (!job->acc.empty())
+			{
+				writeOutput(
+					job,
+					job->desc[desc_addr_outp],
+					job->acc.data(),
+					job->acc.size() * sizeof(uint64_t)
+				);
 			}
+			break;
+		}
+
+		job->state = job_write_out;
+
+		if (job->outputs.empty())
+			publishJob(job);
+	}
+
+	void
+	NDPDevA::publishJob(Job *job)
+	{
+		// Ring jobs complete once their descriptor is written back
+		if (!job->fromRing())
+			recordOp(job->op, job->startTick);
 
-			schedule(
-				new EventFunctionWrapper(
-					[this]
-					{
-						pi_stat_rgst = 1;
-						delete operands;
-						has_operands = false;
-					},
-					name() + ".writeBackResultsEvent",
-					true
-				),
-				clockEdge(Cycles(cycles * scaleFactor))
+		if (job->fromShard())
+		{
+			// The dispatcher reduces the partial results of all shards
+			auto done = job->onDone;
+			uint64_t result = job->desc[desc_result];
+			job->state = job_done;
+			retireJobs();
+			done(result);
+		}
+		else if (job->fromRing())
+		{
+			// Write result and completion flag back to the descriptor
+			job->state = job_write_back;
+			job->desc[desc_status] = 1;
+			accessMemory(
+				job->descAddr + desc_result * sizeof(uint64_t),
+				2 * sizeof(uint64_t),
+				true,
+				(uint8_t *) &job->desc[desc_result]
 			);
 		}
+		else
+		{
+			pi_last_rslt = job->desc[desc_result];
+			pi_stat_rgst = 1;
+			job->state = job_done;
+			retireJobs();
+			notifyCompletion();
+		}
+	}
+
+	void
+	NDPDevA::retireJobs()
+	{
+		// The tail only moves past jobs whose results are in memory
+		while (!jobs.empty() && jobs.front()->state == job_done)
+		{
+			Job *job = jobs.front();
+			jobs.pop_front();
+
+			if (job->fromRing())
+				pi_ring_tail++;
+
+			delete job;
+		}
+
+		// Jobs of a shard complete without an interrupt
+		checkDrain();
 	}
 
 } // namespace gem5
@@ -1,6 +1,13 @@
 #ifndef __NDPDevA_HH__
 #define __NDPDevA_HH__
 
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "base/bitfield.hh"
+
 #include "ndp/ndp.hh"
 
 #include "params/NDPDevA.hh"
@@ -12,9 +19,136 @@ namespace gem5
 {
 	class NDPDevA : public NDP
 	{
+	public:
+
+		// Operation in bits 7:0 of the command code. Bits 9:8 select the
+		// element width (0: 64, 1: 8, 2: 16, 3: 32 bits), bits 14:12 the
+		// predicate of hit, count and filter, and bits 31:16 the number of
+		// buckets of histogram or the k of top-k. Elements are unsigned.
+		enum Op
+		{
+			op_hit,			// 1 if any element satisfies the predicate
+			op_count,		// Elements that satisfy the predicate
+			op_max,
+			op_sum,
+			op_min,
+			op_avg,			// Rounded down
+			op_filter,		// Satisfying elements compacted to the output
+			op_histogram,	// Counters of buckets skey wide to the output
+			op_topk,		// k largest elements, descending, to the output
+			num_ops
+		};
+
+		// Predicates compare the elements against skey
+		enum Pred
+		{
+			pred_eq,
+			pred_ne,
+			pred_lt,
+			pred_le,
+			pred_gt,
+			pred_ge,
+			num_preds
+		};
+
+		static uint64_t cmdOp(uint64_t cmd)
+		{ return bits(cmd, 7, 0); };
+
+		static uint64_t cmdElemSize(uint64_t cmd)
+		{ return bits(cmd, 9, 8) ? 1 << (bits(cmd, 9, 8) - 1) : sizeof(uint64_t); };
+
+		static uint64_t cmdPred(uint64_t cmd)
+		{ return bits(cmd, 14, 12); };
+
+		static uint64_t cmdParam(uint64_t cmd)
+		{ return bits(cmd, 31, 16); };
+
+		// Whether the results of op over disjoint parts of the elements
+		// can be reduced into the result over all of them
+		static bool reducible(uint64_t op)
+		{ return op <= op_avg; };
+
+		static const char *opName(uint64_t op);
+
 	private:
 
-		uint64_t scaleFactor;
+		// Layout of a job descriptor in the command ring (one 64-byte slot
+		// per job). The host writes every word but desc_result and
+		// desc_status, which the device writes back.
+		enum DescWord
+		{
+			desc_addr_data,
+			desc_data_size,
+			desc_data_skey,
+			desc_cmmd_code,
+			desc_scale,
+			desc_result,
+			desc_status,
+			desc_addr_outp,
+			desc_words
+		};
+
+		enum JobState
+		{
+			job_fetch_desc,
+			job_stream_data,
+			job_write_out,
+			job_write_back,
+			job_done
+		};
+
+		// Slice of the operands that is fetched and computed as a unit
+		struct Chunk
+		{
+			uint8_t *data;
+			uint64_t size;		// In elements
+			bool loaded = false;
+
+			Chunk(uint64_t size, uint64_t elemSize) :
+			data(new uint8_t[size * elemSize]), size(size)
+			{ }
+
+			~Chunk()
+			{ delete[] data; }
+		};
+
+		struct Job
+		{
+			uint64_t desc[desc_words] = {};
+			bool ring = false;			// Fetched from a slot of the ring
+			Addr descAddr = 0;			// Slot in the ring
+			JobState state = job_fetch_desc;
+			std::deque<Chunk *> chunks;	// Requested and not yet consumed
+			uint64_t nextElem = 0;		// First element not yet requested
+			uint64_t doneElems = 0;		// Elements already consumed
+			bool stop = false;			// Result known, skip the rest
+			Tick startTick = curTick();
+
+			// Decoded from the command code when the job starts
+			uint64_t op = 0;
+			uint64_t elemSize = sizeof(uint64_t);
+			uint64_t chunkElems = 0;
+
+			// Buckets of histogram or min-heap of the top-k candidates
+			std::vector<uint64_t> acc;
+			// Elements filtered out of the chunk computing
+			std::vector<uint8_t> chunkOut;
+			// Elements written to the output so far
+			uint64_t outElems = 0;
+			// Output writes in flight, by address
+			std::map<Addr, uint8_t *> outputs;
+
+			// Shard jobs only process the elements that lie in range
+			// and report their partial result to the dispatcher
+			AddrRange range = AddrRange(0, MaxAddr);
+			std::function<void(uint64_t)> onDone;
+
+			bool fromRing()
+			{ return ring; };
+
+			bool fromShard()
+			{ return bool(onDone); };
+		};
 
 		uint64_t pi_addr_data = 0;
 	    uint64_t pi_data_size = 0;
@@ -22,17 +156,59 @@ namespace gem5
 	    uint64_t pi_cmmd_code = 0;
 	    uint64_t pi_stat_rgst = 1;
 	    uint64_t pi_last_rslt = 0;
+	    uint64_t pi_ring_base = 0;
+	    uint64_t pi_ring_size = 0;
+	    uint64_t pi_ring_head = 0;
+	    uint64_t pi_ring_tail = 0;
+	    uint64_t pi_addr_outp = 0;
+
+	    // Jobs in the device in submission order
+	    std::deque<Job *> jobs;
+	    // Next ring index whose descriptor is fetched
+	    uint64_t fetchIdx = 0;
+	    // Jobs fetched or fetching that did not finish computing yet
+	    uint64_t residentJobs = 0;
+	    uint64_t maxJobs;
+
+	    // Operands are fetched in chunks of streamChunk bytes (0 for
+	    // whole arrays), with up to streamBuffers chunks per job in flight
+	    uint64_t streamChunk, streamBuffers;
+	    // Bytes of operands the lanes of the compute unit take per cycle
+	    uint64_t simdWidth;
+	    // Chunks still in flight from jobs that stopped early
+	    std::deque<Chunk *> discardedChunks;
+
+	    Job *computingJob = nullptr;
+	    EventFunctionWrapper computeEvent;
+
+	    static bool matches(uint64_t pred, uint64_t value, uint64_t key);
+
+		// Folds a chunk of operands into the job and returns the number
+		// of elements it had to inspect
+		template <typename T>
+		uint64_t computeChunk(Job *job, const T *data, uint64_t size);
 
-	    bool has_operands = false;
-	    uint64_t *operands;
+		Cycles computeCycles(Job *job, uint64_t inspected);
 
-	    uint64_t compare_n_hit(uint64_t *data, uint64_t size, uint64_t skey);
+		void fetchJobs();
 
-		uint64_t compare_n_count(uint64_t *data, uint64_t size, uint64_t skey);
+		void startJob(Job *job);
 
-		uint64_t compare_n_max(uint64_t *data, uint64_t size);
+		void fetchOperands(Job *job);
 
-	    void process_fsm();
+		uint64_t shardRun(const AddrRange &range, Addr addr);
+
+		void writeOutput(Job *job, Addr addr, const void *data, size_t size);
+
+		void finishJob(Job *job);
+
+		void publishJob(Job *job);
+
+		void tryCompute();
+
+		void finishCompute();
+
+		void retireJobs();
 
 	public:
 
@@ -42,8 +218,28 @@ namespace gem5
 
 		void writePI(uint64_t ridx, uint64_t data) override;
 
+		bool peekPI(uint64_t ridx, uint64_t &data) override;
+
+		bool pokePI(uint64_t ridx, uint64_t data) override;
+
+		// Published ring slots are jobs too, even if not fetched yet
+		bool busy() const override
+		{ return !jobs.empty() || fetchIdx != pi_ring_head; }
+
 		void recvData(Addr addr, uint8_t *data, size_t size) override;
 
+		// Runs the part of a job that lies in range (e.g., the addresses of
+		// one memory channel) and calls done with its partial result
+		void submitShard(
+			Addr addr,
+			uint64_t size,
+			uint64_t skey,
+			uint64_t cmd,
+			uint64_t scale,
+			AddrRange range,
+			std::function<void(uint64_t)> done
+		);
+
 	};
 
 }
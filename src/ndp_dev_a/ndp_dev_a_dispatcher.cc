@@ -0,0 +1,151 @@
+#include "ndp_dev_a/ndp_dev_a_dispatcher.hh"
+
+namespace gem5
+{
+	NDPDevADispatcher::NDPDevADispatcher(const NDPDevADispatcherParams &params) :
+	NDP(params),
+	shards(params.shards),
+	shardRanges(params.shard_ranges)
+	{
+		fatal_if(shards.empty(), "NDPDevADispatcher needs at least one shard.\n");
+		fatal_if(
+			shards.size() != shardRanges.size(),
+			"NDPDevADispatcher needs one address range per shard.\n"
+		);
+
+		for (uint64_t op = 0; op < NDPDevA::num_ops; op++)
+			addOp(NDPDevA::opName(op));
+	}
+
+	uint64_t
+	NDPDevADispatcher::readPI(uint64_t ridx)
+	{
+		switch (ridx)
+		{
+		case 5: return pi_stat_rgst;
+	    case 6: return pi_last_rslt;
+	    default:
+	    	panic("NDPDevADispatcher does not have readable r[%lu] register!\n", ridx);
+		}
+	}
+
+	void
+	NDPDevADispatcher::writePI(uint64_t ridx, uint64_t data)
+	{
+		DPRINTF(NDPDevAPI, "NDP dispatcher PI: %lu -> r[%lu]\n", data, ridx);
+
+		if (ridx <= 4 && !pi_stat_rgst)
+		{
+			panic("Tried to started workload when previous one is not finished!\n");
+		}
+
+		switch (ridx)
+		{
+		case 0: pi_addr_data = data; break;
+	    case 1: pi_data_size = data; break;
+	    case 2: pi_data_skey = data; break;
+	    case 3: pi_cmmd_code = data; break;
+	    case 4:
+	    {
+	    	jobOp = NDPDevA::cmdOp(pi_cmmd_code);
+
+	    	// Outputs of filter, histogram and top-k cannot be merged
+	    	panic_if(
+	    		jobOp >= NDPDevA::num_ops || !NDPDevA::reducible(jobOp),
+	    		"Invalid command was issued to NDPDevADispatcher!\n"
+	    	);
+
+	    	pi_stat_rgst = 0;
+	    	pi_last_rslt = jobOp == NDPDevA::op_min ?
+	    		mask(NDPDevA::cmdElemSize(pi_cmmd_code) * 8) : 0;
+	    	pendingShards = shards.size();
+	    	jobStart = curTick();
+
+	    	// Scatter the job, every shard skips the elements of the others
+	    	for (size_t i = 0; i < shards.size(); ++i)
+	    	{
+	    		DPRINTF(
+	    			NDPDevADispatcher,
+	    			"Scattering job to shard %lu (%s)\n",
+	    			i,
+	    			shardRanges[i].to_string()
+	    		);
+	    		shards[i]->submitShard(
+	    			pi_addr_data,
+	    			pi_data_size,
+	    			pi_data_skey,
+	    			pi_cmmd_code,
+	    			data,
+	    			shardRanges[i],
+	    			[this] (uint64_t result) { gatherShard(result); }
+	    		);
+	    	}
+	    	break;
+	    }
+	    default:
+	    	panic("NDPDevADispatcher does not have writable r[%lu] register!\n", ridx);
+		}
+	}
+
+	bool
+	NDPDevADispatcher::peekPI(uint64_t ridx, uint64_t &data)
+	{
+		switch (ridx)
+		{
+		case 0: data = pi_addr_data; return true;
+		case 1: data = pi_data_size; return true;
+		case 2: data = pi_data_skey; return true;
+		case 3: data = pi_cmmd_code; return true;
+		case 5: data = pi_stat_rgst; return true;
+		case 6: data = pi_last_rslt; return true;
+		default: return false;
+		}
+	}
+
+	bool
+	NDPDevADispatcher::pokePI(uint64_t ridx, uint64_t data)
+	{
+		switch (ridx)
+		{
+		case 0: pi_addr_data = data; return true;
+		case 1: pi_data_size = data; return true;
+		case 2: pi_data_skey = data; return true;
+		case 3: pi_cmmd_code = data; return true;
+		default: return false;
+		}
+	}
+
+	void
+	NDPDevADispatcher::gatherShard(uint64_t result)
+	{
+		// Reduce the partial result as the command of the job requires
+		switch (jobOp)
+		{
+		case NDPDevA::op_hit: pi_last_rslt |= result; break;
+		case NDPDevA::op_count:
+		case NDPDevA::op_sum:
+		case NDPDevA::op_avg: pi_last_rslt += result; break;
+		case NDPDevA::op_max: pi_last_rslt = std::max(pi_last_rslt, result); break;
+		case NDPDevA::op_min: pi_last_rslt = std::min(pi_last_rslt, result); break;
+		}
+
+		DPRINTF(
+			NDPDevADispatcher,
+			"Gathered partial result %lu, %lu shards pending\n",
+			result,
+			pendingShards - 1
+		);
+
+		if (--pendingShards == 0)
+		{
+			// Shards report sums, every element belongs to exactly one
+			if (jobOp == NDPDevA::op_avg)
+				pi_last_rslt = pi_data_size ? pi_last_rslt / pi_data_size : 0;
+
+			pi_stat_rgst = 1;
+			recordOp(jobOp, jobStart);
+			notifyCompletion();
+		}
+	}
+
+} // namespace gem5
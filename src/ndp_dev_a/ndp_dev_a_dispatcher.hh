@@ -0,0 +1,57 @@
+#ifndef __NDPDevADispatcher_HH__
+#define __NDPDevADispatcher_HH__
+
+#include <vector>
+
+#include "ndp_dev_a/ndp_dev_a.hh"
+
+#include "params/NDPDevADispatcher.hh"
+#include "debug/NDPDevADispatcher.hh"
+
+namespace gem5
+{
+	// Exposes several NDPDevA shards (e.g., one per memory channel) behind
+	// a single PI with the layout of the NDPDevA PI. A job is scattered to
+	// all shards, each processing the elements that lie in its address
+	// range, and their partial results are reduced into the final one.
+	class NDPDevADispatcher : public NDP
+	{
+	private:
+
+		uint64_t pi_addr_data = 0;
+	    uint64_t pi_data_size = 0;
+	    uint64_t pi_data_skey = 0;
+	    uint64_t pi_cmmd_code = 0;
+	    uint64_t pi_stat_rgst = 1;
+	    uint64_t pi_last_rslt = 0;
+
+	    std::vector<NDPDevA *> shards;
+	    std::vector<AddrRange> shardRanges;
+
+	    // Shards that did not report their partial result yet
+	    uint64_t pendingShards = 0;
+	    uint64_t jobOp = 0;
+	    Tick jobStart = 0;
+
+	    void gatherShard(uint64_t result);
+
+	public:
+
+		NDPDevADispatcher(const NDPDevADispatcherParams &params);
+
+		uint64_t readPI(uint64_t ridx) override;
+
+		void writePI(uint64_t ridx, uint64_t data) override;
+
+		bool peekPI(uint64_t ridx, uint64_t &data) override;
+
+		bool pokePI(uint64_t ridx, uint64_t data) override;
+
+		bool busy() const override
+		{ return !pi_stat_rgst; }
+
+	};
+
+}
+
+#endif //__NDPDevADispatcher_HH__
@@ -0,0 +1,11 @@
+from m5.params import *
+from m5.proxy import *
+from m5.objects.NDP import NDP
+
+class NDPDevProg(NDP):
+	type = 'NDPDevProg'
+	cxx_header = "ndp_dev_prog/ndp_dev_prog.hh"
+	cxx_class = 'gem5::NDPDevProg'
+
+	kernels = VectorParam.String([], "Shared objects (see ndp_kernel.h) whose kernels the device runs, in command code order")
+	stream_buffers = Param.Unsigned(2, "Number of input tiles of a job buffered ahead of the computation")
@@ -0,0 +1,362 @@
+#include "ndp_dev_prog/ndp_dev_prog.hh"
+
+#include <dlfcn.h>
+
+#include "base/intmath.hh"
+
+namespace gem5
+{
+	NDPDevProg::NDPDevProg(const NDPDevProgParams &params) :
+	NDP(params),
+	streamBuffers(params.stream_buffers),
+	computeEvent([this] { finishCompute(); }, name() + ".computeEvent")
+	{
+		fatal_if(streamBuffers == 0, "NDPDevProg stream_buffers must be at least 1.\n");
+
+		loadKernels(params.kernels);
+	}
+
+	NDPDevProg::~NDPDevProg()
+	{
+		for (void *library : libraries)
+			dlclose(library);
+	}
+
+	void
+	NDPDevProg::loadKernels(const std::vector<std::string> &paths)
+	{
+		for (const std::string &path : paths)
+		{
+			void *library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+			fatal_if(
+				!library,
+				"NDPDevProg could not load kernels from %s: %s\n",
+				path, dlerror()
+			);
+			libraries.push_back(library);
+
+			auto entry = (ndp_kernels_fn) dlsym(library, "ndp_kernels");
+			fatal_if(!entry, "%s does not export ndp_kernels.\n", path);
+
+			uint32_t count = 0;
+			const ndp_kernel *table = entry(&count);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const ndp_kernel *k = &table[i];
+
+				fatal_if(
+					k->abi != NDP_KERNEL_ABI,
+					"Kernel %u of %s was built for ABI %u instead of %u.\n",
+					i, path, k->abi, NDP_KERNEL_ABI
+				);
+				fatal_if(
+					!k->name || !k->step || !k->in_elem_size || !k->lanes,
+					"Kernel %u of %s needs a name, step, in_elem_size and lanes.\n",
+					i, path
+				);
+
+				DPRINTF(
+					NDPDevProg,
+					"Loaded kernel %s from %s as command %lu\n",
+					k->name, path, kernels.size()
+				);
+
+				kernels.push_back(k);
+				addOp(k->name);
+			}
+		}
+	}
+
+	uint64_t
+	NDPDevProg::readPI(uint64_t ridx)
+	{
+		switch (ridx)
+		{
+		case 5: return pi_stat_rgst;
+		case 6: return pi_last_rslt;
+		case 7: return pi_last_outs;
+		case 8: return kernels.size();
+		default:
+			panic("NDPDevProg does not have readable r[%lu] register!\n", ridx);
+		}
+	}
+
+	void
+	NDPDevProg::writePI(uint64_t ridx, uint64_t data)
+	{
+		DPRINTF(NDPDevProgPI, "NDP device PI: %lu -> r[%lu]\n", data, ridx);
+
+		panic_if(
+			ridx <= 4 && !pi_stat_rgst,
+			"Tried to started workload when previous one is not finished!\n"
+		);
+
+		switch (ridx)
+		{
+		case 0: pi_addr_data = data; break;
+		case 1: pi_data_size = data; break;
+		case 2: pi_addr_outp = data; break;
+		case 3: pi_kern_argm = data; break;
+		case 4: startJob(data); break;
+		default:
+			panic("NDPDevProg does not have writable r[%lu] register!\n", ridx);
+		}
+	}
+
+	bool
+	NDPDevProg::peekPI(uint64_t ridx, uint64_t &data)
+	{
+		switch (ridx)
+		{
+		case 0: data = pi_addr_data; return true;
+		case 1: data = pi_data_size; return true;
+		case 2: data = pi_addr_outp; return true;
+		case 3: data = pi_kern_argm; return true;
+		case 5: case 6: case 7: case 8:
+			data = readPI(ridx);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool
+	NDPDevProg::pokePI(uint64_t ridx, uint64_t data)
+	{
+		switch (ridx)
+		{
+		case 0: pi_addr_data = data; return true;
+		case 1: pi_data_size = data; return true;
+		case 2: pi_addr_outp = data; return true;
+		case 3: pi_kern_argm = data; return true;
+		default: return false;
+		}
+	}
+
+	void
+	NDPDevProg::startJob(uint64_t idx)
+	{
+		panic_if(
+			idx >= kernels.size(),
+			"NDPDevProg has no kernel %lu (%lu loaded)!\n",
+			idx, kernels.size()
+		);
+
+		kernel = kernels[idx];
+		kernelIdx = idx;
+
+		DPRINTF(
+			NDPDevProg,
+			"NDPDevProg started kernel %s on %lu elements from %p\n",
+			kernel->name, pi_data_size, pi_addr_data
+		);
+
+		pi_stat_rgst = 0;
+		job = {};
+		job.arg = pi_kern_argm;
+		job.elems = pi_data_size;
+		jobStart = curTick();
+		nextElem = 0;
+		doneElems = 0;
+		outElems = 0;
+		stop = false;
+		streamDone = false;
+
+		if (kernel->start)
+			kernel->start(&job);
+
+		fetchTiles();
+		tryCompute();
+	}
+
+	void
+	NDPDevProg::fetchTiles()
+	{
+		uint64_t tileElems = kernel->tile_elems ? kernel->tile_elems : job.elems;
+
+		// Keep up to streamBuffers tiles requested
+		while (!stop && nextElem < job.elems && tiles.size() < streamBuffers)
+		{
+			Tile *tile = new Tile(
+				std::min(tileElems, job.elems - nextElem),
+				kernel->in_elem_size
+			);
+			Addr addr = pi_addr_data + nextElem * kernel->in_elem_size;
+			tiles.push_back(tile);
+			nextElem += tile->elems;
+
+			DPRINTF(
+				NDPDevProg,
+				"Retrieving tile from memory: %lu bytes from %p\n",
+				tile->elems * kernel->in_elem_size,
+				addr
+			);
+			accessMemory(
+				addr,
+				tile->elems * kernel->in_elem_size,
+				false,
+				tile->data
+			);
+		}
+	}
+
+	void
+	NDPDevProg::recvData(Addr addr, uint8_t *data, size_t size)
+	{
+		DPRINTF(NDPDevProg, "NDPDevProg received %u bytes from %p\n", size, addr);
+
+		if (!data)
+		{
+			auto it = outputs.find(addr);
+			panic_if(it == outputs.end(), "NDPDevProg wrote to unknown %p!\n", addr);
+
+			delete[] it->second;
+			outputs.erase(it);
+
+			if (streamDone && outputs.empty())
+				finishJob();
+			return;
+		}
+
+		for (Tile *tile : tiles)
+		{
+			if (data == tile->data)
+			{
+				tile->loaded = true;
+				tryCompute();
+				return;
+			}
+		}
+
+		for (auto it = discardedTiles.begin(); it != discardedTiles.end(); ++it)
+		{
+			if (data == (*it)->data)
+			{
+				delete *it;
+				discardedTiles.erase(it);
+				return;
+			}
+		}
+
+		panic("NDPDevProg received data that belongs to no job!\n");
+	}
+
+	void
+	NDPDevProg::tryCompute()
+	{
+		if (!kernel || streamDone || computing)
+			return;
+
+		// The whole stream (possibly empty) was consumed or is not needed
+		if (stop || doneElems == job.elems)
+		{
+			finishStream();
+			return;
+		}
+
+		Tile *tile = tiles.front();
+		if (!tile->loaded)
+			return;
+
+		int stopped = 0;
+		tileOutElems = 0;
+		if (kernel->out_elem_size)
+			tileOut = new uint8_t[tile->elems * kernel->out_elem_size];
+
+		uint64_t inspected = kernel->step(
+			&job, tile->data, tile->elems, tileOut, &tileOutElems, &stopped
+		);
+
+		panic_if(
+			tileOutElems > tile->elems,
+			"Kernel %s produced %lu outputs from %lu elements!\n",
+			kernel->name, tileOutElems, tile->elems
+		);
+
+		stop = stopped != 0;
+
+		// Near-bank units split the tile, each scanning its own banks
+		Cycles cycles(divCeil(
+			kernel->tile_cycles +
+			divCeil(inspected, kernel->lanes) * kernel->elem_cycles,
+			computeUnits()
+		));
+		recordCompute(cycles);
+
+		computing = true;
+
+		// Later tiles keep streaming in while this one computes
+		schedule(computeEvent, clockEdge(cycles));
+	}
+
+	void
+	NDPDevProg::finishCompute()
+	{
+		computing = false;
+
+		Tile *tile = tiles.front();
+		tiles.pop_front();
+		doneElems += tile->elems;
+		delete tile;
+
+		if (tileOutElems)
+		{
+			Addr addr = pi_addr_outp + outElems * kernel->out_elem_size;
+			outputs[addr] = tileOut;
+			outElems += tileOutElems;
+
+			accessMemory(addr, tileOutElems * kernel->out_elem_size, true, tileOut);
+		}
+		else
+			delete[] tileOut;
+
+		tileOut = nullptr;
+
+		fetchTiles();
+		tryCompute();
+	}
+
+	void
+	NDPDevProg::finishStream()
+	{
+		streamDone = true;
+
+		if (kernel->finish)
+			kernel->finish(&job);
+
+		// Drop the tiles the job no longer needs
+		for (Tile *tile : tiles)
+		{
+			if (tile->loaded)
+				delete tile;
+			else
+				discardedTiles.push_back(tile);
+		}
+		tiles.clear();
+
+		// Outputs must be in memory before the host sees the job done
+		if (outputs.empty())
+			finishJob();
+	}
+
+	void
+	NDPDevProg::finishJob()
+	{
+		DPRINTF(
+			NDPDevProg,
+			"NDPDevProg finished kernel %s: result %lu, %lu outputs\n",
+			kernel->name, job.result, outElems
+		);
+
+		recordOp(kernelIdx, jobStart);
+
+		pi_last_rslt = job.result;
+		pi_last_outs = outElems;
+		pi_stat_rgst = 1;
+		kernel = nullptr;
+
+		notifyCompletion();
+	}
+
+} // namespace gem5
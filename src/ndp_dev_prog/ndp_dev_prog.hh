@@ -0,0 +1,114 @@
+#ifndef __NDPDevProg_HH__
+#define __NDPDevProg_HH__
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ndp/ndp.hh"
+#include "ndp_dev_prog/ndp_kernel.h"
+
+#include "params/NDPDevProg.hh"
+#include "debug/NDPDevProg.hh"
+#include "debug/NDPDevProgPI.hh"
+
+namespace gem5
+{
+	// NDP device whose operations are kernels loaded from shared objects
+	// (see ndp_kernel.h), the command code of a job selects the kernel
+	class NDPDevProg : public NDP
+	{
+	private:
+
+		// Input elements that are fetched and computed as a unit
+		struct Tile
+		{
+			uint8_t *data;
+			uint64_t elems;
+			bool loaded = false;
+
+			Tile(uint64_t elems, uint64_t elemSize) :
+			data(new uint8_t[elems * elemSize]), elems(elems)
+			{ }
+
+			~Tile()
+			{ delete[] data; }
+		};
+
+		uint64_t pi_addr_data = 0;
+		uint64_t pi_data_size = 0;
+		uint64_t pi_addr_outp = 0;
+		uint64_t pi_kern_argm = 0;
+		uint64_t pi_stat_rgst = 1;
+		uint64_t pi_last_rslt = 0;
+		uint64_t pi_last_outs = 0;
+
+		// Handles of the loaded libraries and their kernels in command
+		// code order
+		std::vector<void *> libraries;
+		std::vector<const ndp_kernel *> kernels;
+
+		// Running job, kernel is null while the device is idle
+		const ndp_kernel *kernel = nullptr;
+		uint64_t kernelIdx = 0;
+		ndp_kernel_job job = {};
+		Tick jobStart = 0;
+		uint64_t nextElem = 0;		// First element not yet requested
+		uint64_t doneElems = 0;		// Elements already consumed
+		uint64_t outElems = 0;		// Output elements produced
+		bool stop = false;			// Kernel needs no more elements
+		bool streamDone = false;	// Kernel finished, outputs may be in flight
+
+		uint64_t streamBuffers;
+		std::deque<Tile *> tiles;
+		// Tiles still in flight from jobs that stopped early
+		std::deque<Tile *> discardedTiles;
+		// Output tiles being written back, by address
+		std::unordered_map<Addr, uint8_t *> outputs;
+
+		// Output of the tile computing, written back when it finishes
+		uint8_t *tileOut = nullptr;
+		uint64_t tileOutElems = 0;
+
+		bool computing = false;
+		EventFunctionWrapper computeEvent;
+
+		void loadKernels(const std::vector<std::string> &paths);
+
+		void startJob(uint64_t idx);
+
+		void fetchTiles();
+
+		void tryCompute();
+
+		void finishCompute();
+
+		void finishStream();
+
+		void finishJob();
+
+	public:
+
+		NDPDevProg(const NDPDevProgParams &params);
+
+		~NDPDevProg();
+
+		uint64_t readPI(uint64_t ridx) override;
+
+		void writePI(uint64_t ridx, uint64_t data) override;
+
+		bool peekPI(uint64_t ridx, uint64_t &data) override;
+
+		bool pokePI(uint64_t ridx, uint64_t data) override;
+
+		bool busy() const override
+		{ return !pi_stat_rgst; }
+
+		void recvData(Addr addr, uint8_t *data, size_t size) override;
+
+	};
+
+}
+
+#endif //__NDPDevProg_HH__
@@ -0,0 +1,76 @@
+#ifndef __NDP_KERNEL_H__
+#define __NDP_KERNEL_H__
+
+/*
+ * Interface between NDPDevProg and the kernels it runs. Kernels are
+ * built as shared objects against this header only (no gem5 headers)
+ * and are loaded when the simulation starts, so new kernel variants do
+ * not require rebuilding gem5.
+ *
+ * A job streams elems input elements from memory in tiles, folds every
+ * tile into its result with step() and optionally streams output
+ * elements back to memory.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NDP_KERNEL_ABI 1
+
+struct ndp_kernel_job
+{
+	uint64_t arg;		/* Argument written to the PI by the host */
+	uint64_t elems;		/* Elements of the input stream */
+	uint64_t result;	/* Read back by the host through the PI */
+	void *state;		/* Private to the kernel */
+};
+
+struct ndp_kernel
+{
+	uint32_t abi;				/* Must be NDP_KERNEL_ABI */
+	const char *name;			/* Names the statistics of the kernel */
+
+	/* Streaming and tiling descriptor */
+	uint32_t in_elem_size;		/* Bytes of an input element */
+	uint32_t out_elem_size;		/* Bytes of an output element, 0 for none */
+	uint64_t tile_elems;		/* Input elements per tile, 0 for all */
+
+	/* Cost model of a tile: tile_cycles + ceil(n / lanes) * elem_cycles,
+	   where n is the number of elements step() inspected */
+	uint32_t lanes;
+	uint64_t tile_cycles;
+	uint64_t elem_cycles;
+
+	/* Optional, called before the first tile of a job */
+	void (*start)(struct ndp_kernel_job *job);
+
+	/* Folds a tile of elems input elements into the job and returns the
+	   number of elements it inspected. It may write up to elems output
+	   elements to out, storing how many in *out_elems, and set *stop when
+	   the rest of the stream is not needed */
+	uint64_t (*step)(
+		struct ndp_kernel_job *job,
+		const void *in,
+		uint64_t elems,
+		void *out,
+		uint64_t *out_elems,
+		int *stop
+	);
+
+	/* Optional, called once the job consumed its stream */
+	void (*finish)(struct ndp_kernel_job *job);
+};
+
+/* Entry point every kernel library exports */
+typedef const struct ndp_kernel *(*ndp_kernels_fn)(uint32_t *count);
+
+const struct ndp_kernel *ndp_kernels(uint32_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __NDP_KERNEL_H__
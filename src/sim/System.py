@@ -50,6 +50,10 @@ class MemoryMode(Enum):
     vals = ["invalid", "atomic", "timing", "atomic_noncaching"]
 
 
+class MemoryCheckpointFormat(ScopedEnum):
+    vals = ["gzip", "chunked", "raw"]
+
+
 class System(SimObject):
     type = "System"
     cxx_header = "sim/system.hh"
@@ -105,6 +109,34 @@ class System(SimObject):
         "shared_backstore is non-empty.",
     )
 
+    # The backing stores are checkpointed either as a single gzip stream
+    # each, as blocks that are compressed and restored in parallel,
+    # leaving out the all-zero ones, or uncompressed (raw). Raw stores
+    # are restored by mapping the file copy-on-write in place of the
+    # backing store, so pages are only read when first touched and
+    # simulations restoring the same checkpoint share them in the host
+    # page cache. Checkpoints record their format, so all of them can be
+    # restored whatever this is set to.
+    memory_checkpoint_format = Param.MemoryCheckpointFormat(
+        "gzip", "Format of the memory in new checkpoints"
+    )
+    memory_checkpoint_threads = Param.Unsigned(
+        0,
+        "Threads writing and reading chunked and raw memory checkpoints, "
+        "0 for one per host CPU",
+    )
+    memory_checkpoint_block_size = Param.MemorySize(
+        "1MiB", "Uncompressed size of the blocks of chunked checkpoints"
+    )
+    # Incremental checkpoints only store the pages written since the
+    # previous checkpoint taken or restored by this simulation and refer
+    # to it for the rest, so restoring them needs the whole chain.
+    # Backing stores that may have been written without going through
+    # the memories (backdoors, KVM) are stored in full.
+    memory_checkpoint_delta = Param.Bool(
+        False, "Checkpoint only the memory pages written since the parent"
+    )
+
     cache_line_size = Param.Unsigned(64, "Cache line size in bytes")
 
     redirect_paths = VectorParam.RedirectPath([], "Path redirections")
@@ -39,6 +39,7 @@
 
 #include "base/logging.hh"
 #include "base/trace.hh"
+#include "config/use_calendar_eventq.hh"
 #include "cpu/smt.hh"
 #include "debug/Checkpoint.hh"
 
@@ -108,27 +109,66 @@ Event::insertBefore(Event *event, Event *curr)
     return event;
 }
 
+Event *
+EventQueue::findPrevBin(const Event *event) const
+{
+#if USE_CALENDAR_EVENTQ
+    if (Event *prev = calendar.predecessor(event))
+        return prev;
+#endif
+
+    Event *prev = head;
+    Event *curr = head->nextBin;
+    while (curr && *curr < *event) {
+        prev = curr;
+        curr = curr->nextBin;
+    }
+
+    return prev;
+}
+
+void
+EventQueue::updateBinTop(Event *top, Event *new_top, Event *prev)
+{
+    // new_top is either the next event of the same bin or the next bin
+    if (new_top && *new_top == *top)
+        calendar.replace(top, new_top);
+    else
+        calendar.remove(top, prev);
+}
+
 void
 EventQueue::insert(Event *event)
 {
     // Deal with the head case
     if (!head || *event <= *head) {
+        Event *old_head = head;
         head = Event::insertBefore(event, head);
+
+#if USE_CALENDAR_EVENTQ
+        if (old_head && *old_head == *event)
+            calendar.replace(old_head, event);
+        else
+            calendar.insert(event, nullptr);
+#endif
         return;
     }
 
     // Figure out either which 'in bin' list we are on, or where a new list
     // needs to be inserted
-    Event *prev = head;
-    Event *curr = head->nextBin;
-    while (curr && *curr < *event) {
-        prev = curr;
-        curr = curr->nextBin;
-    }
+    Event *prev = findPrevBin(event);
+    Event *curr = prev->nextBin;
 
     // Note: this operation may render all nextBin pointers on the
     // prev 'in bin' list stale (except for the top one)
     prev->nextBin = Event::insertBefore(event, curr);
+
+#if USE_CALENDAR_EVENTQ
+    if (curr && *curr == *event)
+        calendar.replace(curr, event);
+    else
+        calendar.insert(event, prev);
+#endif
 }
 
 Event *
@@ -173,17 +213,19 @@ EventQueue::remove(Event *event)
     // deal with an event on the head's 'in bin' list (event has the same
     // time as the head)
     if (*head == *event) {
+        Event *old_head = head;
         head = Event::removeItem(event, head);
+
+#if USE_CALENDAR_EVENTQ
+        if (old_head != head)
+            updateBinTop(old_head, head, nullptr);
+#endif
         return;
     }
 
     // Find the 'in bin' list that this event belongs on
-    Event *prev = head;
-    Event *curr = head->nextBin;
-    while (curr && *curr < *event) {
-        prev = curr;
-        curr = curr->nextBin;
-    }
+    Event *prev = findPrevBin(event);
+    Event *curr = prev->nextBin;
 
     if (!curr || *curr != *event)
         panic("event not found!");
@@ -192,6 +234,11 @@ EventQueue::remove(Event *event)
     // we remove an item, it returns the new top item (which may be
     // unchanged)
     prev->nextBin = Event::removeItem(event, curr);
+
+#if USE_CALENDAR_EVENTQ
+    if (prev->nextBin != curr)
+        updateBinTop(curr, prev->nextBin, prev);
+#endif
 }
 
 Event *
@@ -214,6 +261,10 @@ EventQueue::serviceOne()
         head = head->nextBin;
     }
 
+#if USE_CALENDAR_EVENTQ
+    updateBinTop(event, head, nullptr);
+#endif
+
     // handle action
     if (!event->squashed()) {
         // forward current cycle to the time when this event occurs.
@@ -357,6 +408,16 @@ EventQueue::replaceHead(Event* s)
 {
     Event* t = head;
     head = s;
+
+#if USE_CALENDAR_EVENTQ
+    // The calendar must index the bins of the new list
+    calendar.clear();
+    for (Event *prev = nullptr, *bin = head; bin;
+         prev = bin, bin = bin->nextBin) {
+        calendar.insert(bin, prev);
+    }
+#endif
+
     return t;
 }
 
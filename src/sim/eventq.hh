@@ -50,6 +50,7 @@
 #include "base/uncontended_mutex.hh"
 #include "debug/Event.hh"
 #include "sim/cur_tick.hh"
+#include "sim/eventq_calendar.hh"
 #include "sim/serialize.hh"
 
 namespace gem5
@@ -628,6 +629,18 @@ class EventQueue
     Event *head;
     Tick _curTick;
 
+    //! Index of the bins, only used when gem5 is built with
+    //! USE_CALENDAR_EVENTQ
+    EventCalendar calendar;
+
+    //! Bin (top event) after which event goes, event must be later
+    //! than the head
+    Event *findPrevBin(const Event *event) const;
+
+    //! The bin topped by top, which follows prev, is now topped by
+    //! new_top or is gone if new_top is another bin
+    void updateBinTop(Event *top, Event *new_top, Event *prev);
+
     //! Mutex to protect async queue.
     UncontendedMutex async_queue_mutex;
 
@@ -0,0 +1,216 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "sim/eventq.hh"
+#include "sim/eventq_calendar.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+class TestEvent : public Event
+{
+  public:
+    TestEvent(Priority p = Default_Pri) : Event(p) {}
+
+    void process() override {}
+};
+
+// Event of the hold model: every time it is serviced, it schedules
+// itself again a random delay later, so the number of pending events
+// stays constant
+class HoldEvent : public Event
+{
+  private:
+    EventQueue &eq;
+    std::mt19937_64 &rng;
+
+  public:
+    HoldEvent(EventQueue &_eq, std::mt19937_64 &_rng) : eq(_eq), rng(_rng)
+    {}
+
+    void
+    process() override
+    {
+        eq.schedule(this, eq.getCurTick() + 1 + rng() % 10000);
+    }
+};
+
+bool
+earlier(const Event *l, const Event *r)
+{
+    return *l < *r;
+}
+
+} // anonymous namespace
+
+/*
+ * The calendar must either find the latest bin earlier than an event
+ * or give up, it must never return a wrong bin.
+ */
+TEST(EventCalendarTest, Predecessor)
+{
+    std::mt19937_64 rng(1);
+    std::vector<std::unique_ptr<TestEvent>> events;
+    EventQueue eq("test");
+
+    // Bins spread over a few thousand ticks with a few far ones
+    std::vector<Event *> bins;
+    for (int i = 0; i < 2000; i++) {
+        auto &e = events.emplace_back(
+            new TestEvent(Event::Default_Pri + (int)(rng() % 3)));
+        Tick when = i % 100 ? rng() % 5000 : rng() % 100000000;
+        if (std::none_of(bins.begin(), bins.end(), [&](Event *b) {
+                return b->when() == when && b->priority() == e->priority();
+            })) {
+            eq.schedule(e.get(), when);
+            bins.push_back(e.get());
+        }
+    }
+    std::sort(bins.begin(), bins.end(), earlier);
+
+    EventCalendar calendar;
+    for (size_t i = 0; i < bins.size(); i++)
+        calendar.insert(bins[i], i ? bins[i - 1] : nullptr);
+    ASSERT_EQ(calendar.size(), bins.size());
+
+    // Remove every third bin to shrink the calendar
+    std::vector<Event *> left;
+    for (size_t i = 0; i < bins.size(); i++) {
+        if (i % 3 == 1)
+            calendar.remove(bins[i], left.empty() ? nullptr : left.back());
+        else
+            left.push_back(bins[i]);
+    }
+    ASSERT_EQ(calendar.size(), left.size());
+
+    size_t found = 0;
+    for (int i = 0; i < 2000; i++) {
+        auto &probe = events.emplace_back(new TestEvent());
+        eq.schedule(probe.get(), rng() % 6000);
+
+        auto it = std::lower_bound(left.begin(), left.end(), probe.get(),
+                                   earlier);
+        Event *expected = it == left.begin() ? nullptr : *(it - 1);
+        Event *prev = calendar.predecessor(probe.get());
+
+        if (prev) {
+            EXPECT_EQ(prev, expected);
+            found++;
+        }
+    }
+
+    // Most probes fall among dense bins, where the calendar works
+    EXPECT_GT(found, 1900);
+
+    // Events past the latest bin go right after it
+    auto &last = events.emplace_back(new TestEvent());
+    eq.schedule(last.get(), MaxTick - 1);
+    EXPECT_EQ(calendar.predecessor(last.get()), left.back());
+}
+
+/*
+ * Events are serviced by time and priority whichever way the queue
+ * is indexed, also after descheduling and rescheduling some of them.
+ */
+TEST(EventQueueTest, ServiceOrder)
+{
+    std::mt19937_64 rng(2);
+    std::vector<std::unique_ptr<TestEvent>> events;
+    EventQueue eq("test");
+
+    for (int i = 0; i < 20000; i++) {
+        auto &e = events.emplace_back(
+            new TestEvent(Event::Default_Pri + (int)(rng() % 3)));
+        eq.schedule(e.get(), rng() % 50000);
+    }
+
+    for (int i = 0; i < 20000; i += 7)
+        eq.deschedule(events[i].get());
+    for (int i = 0; i < 20000; i += 5)
+        eq.reschedule(events[i].get(), rng() % 50000, true);
+
+    ASSERT_TRUE(eq.debugVerify());
+
+    size_t scheduled = std::count_if(events.begin(), events.end(),
+                                     [](auto &e) { return e->scheduled(); });
+
+    Tick when = 0;
+    Event::Priority priority = Event::Minimum_Pri;
+    size_t serviced = 0;
+    while (!eq.empty()) {
+        Event *head = eq.getHead();
+        EXPECT_TRUE(head->when() > when || (head->when() == when &&
+                                            head->priority() >= priority));
+        when = head->when();
+        priority = head->priority();
+        eq.serviceOne();
+        serviced++;
+    }
+
+    EXPECT_EQ(serviced, scheduled);
+}
+
+/*
+ * Insert/service throughput against the number of pending events (hold
+ * model). Disabled by default, run it with
+ *   build/ALL/sim/eventq.test.opt --gtest_also_run_disabled_tests
+ * on builds with and without USE_CALENDAR_EVENTQ to compare them.
+ */
+TEST(EventQueueBench, DISABLED_Hold)
+{
+    const int operations = 1000000;
+
+    for (int pending : {10, 100, 1000, 10000, 100000}) {
+        std::mt19937_64 rng(3);
+        std::vector<std::unique_ptr<HoldEvent>> events;
+        EventQueue eq("bench");
+
+        for (int i = 0; i < pending; i++) {
+            auto &e = events.emplace_back(new HoldEvent(eq, rng));
+            eq.schedule(e.get(), rng() % 10000);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < operations; i++)
+            eq.serviceOne();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        std::cout << pending << " pending events: "
+                  << operations / elapsed.count() / 1e6
+                  << " M insert+service/s" << std::endl;
+    }
+}
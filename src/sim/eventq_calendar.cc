@@ -0,0 +1,154 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sim/eventq_calendar.hh"
+
+#include <algorithm>
+
+#include "base/intmath.hh"
+#include "sim/eventq.hh"
+
+namespace gem5
+{
+
+EventCalendar::EventCalendar()
+    : buckets(MinBuckets), shift(10), bins(0), latest(nullptr)
+{
+}
+
+Event *
+EventCalendar::predecessor(const Event *event) const
+{
+    if (latest && *latest < *event)
+        return latest;
+
+    // Walk the days backwards, starting with the day of the event,
+    // until one of them has a bin earlier than the event
+    Tick day = event->when() >> shift;
+    for (size_t i = 0; i < buckets.size(); i++, day--) {
+        Event *found = nullptr;
+        for (Event *top : buckets[day & (buckets.size() - 1)]) {
+            if ((top->when() >> shift) == day && *top < *event &&
+                (!found || *found < *top)) {
+                found = top;
+            }
+        }
+
+        if (found || day == 0)
+            return found;
+    }
+
+    return nullptr;
+}
+
+void
+EventCalendar::insert(Event *top, Event *prev)
+{
+    buckets[bucket(top->when())].push_back(top);
+    bins++;
+
+    if (!latest || prev == latest)
+        latest = top;
+
+    if (bins > 2 * buckets.size())
+        resize(2 * buckets.size());
+}
+
+void
+EventCalendar::remove(Event *top, Event *prev)
+{
+    auto &b = buckets[bucket(top->when())];
+    auto it = std::find(b.begin(), b.end(), top);
+    assert(it != b.end());
+    *it = b.back();
+    b.pop_back();
+    bins--;
+
+    if (latest == top)
+        latest = prev;
+
+    if (bins < buckets.size() / 2 && buckets.size() > MinBuckets)
+        resize(buckets.size() / 2);
+}
+
+void
+EventCalendar::replace(Event *top, Event *new_top)
+{
+    auto &b = buckets[bucket(top->when())];
+    auto it = std::find(b.begin(), b.end(), top);
+    assert(it != b.end());
+    *it = new_top;
+
+    if (latest == top)
+        latest = new_top;
+}
+
+void
+EventCalendar::clear()
+{
+    buckets.assign(MinBuckets, {});
+    bins = 0;
+    latest = nullptr;
+}
+
+void
+EventCalendar::resize(size_t num_buckets)
+{
+    std::vector<Event *> tops;
+    tops.reserve(bins);
+    for (auto &b : buckets)
+        tops.insert(tops.end(), b.begin(), b.end());
+
+    std::sort(tops.begin(), tops.end(),
+              [](const Event *l, const Event *r) { return *l < *r; });
+
+    // A day should cover a few bins at the front of the queue, which
+    // is where most of the activity is. Like in Brown's calendar
+    // queue, separations more than twice the average are left out
+    // of the estimate.
+    size_t samples = std::min<size_t>(tops.size(), 25);
+    if (samples > 1) {
+        Tick average = (tops[samples - 1]->when() - tops[0]->when()) /
+                       (samples - 1);
+        Tick sum = 0;
+        size_t count = 0;
+        for (size_t i = 1; i < samples; i++) {
+            Tick gap = tops[i]->when() - tops[i - 1]->when();
+            if (gap <= 2 * average) {
+                sum += gap;
+                count++;
+            }
+        }
+
+        if (sum)
+            shift = std::min(ceilLog2(std::max<Tick>(1, 3 * sum / count)), 62);
+    }
+
+    buckets.assign(num_buckets, {});
+    for (Event *top : tops)
+        buckets[bucket(top->when())].push_back(top);
+}
+
+} // namespace gem5
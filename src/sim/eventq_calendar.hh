@@ -0,0 +1,113 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* @file
+ * Calendar queue index over the bins of an EventQueue
+ */
+
+#ifndef __SIM_EVENTQ_CALENDAR_HH__
+#define __SIM_EVENTQ_CALENDAR_HH__
+
+#include <cstddef>
+#include <vector>
+
+#include "base/types.hh"
+
+namespace gem5
+{
+
+class Event;
+
+/**
+ * Calendar queue (R. Brown, "Calendar Queues", CACM 1988) of the bins
+ * (events with the same time and priority) of an EventQueue. The
+ * EventQueue keeps its sorted list of bins, so that its head and the
+ * order in which events are serviced do not change. The calendar only
+ * replaces the linear walk over that list when looking for the bin
+ * that precedes an event on insertion or removal.
+ *
+ * Bins are hashed by time into buckets ("days") of 2^shift ticks. The
+ * predecessor of an event is the latest bin of its own day that is
+ * earlier than it or, failing that, the latest bin of the closest
+ * earlier day, so it is found in constant expected time when the
+ * width of a day is close to the average separation of bins. The
+ * number of buckets follows the number of bins and the width is
+ * recalibrated from the bins at the front of the queue on every
+ * resize.
+ *
+ * The calendar tracks bins by their top event, which changes when an
+ * event is pushed onto or popped from the stack of a bin.
+ */
+class EventCalendar
+{
+  private:
+    std::vector<std::vector<Event *>> buckets;
+
+    //! log2 of the ticks covered by a day
+    unsigned shift;
+
+    //! Number of bins in the calendar
+    size_t bins;
+
+    //! Top of the latest bin, most schedules happen past it
+    Event *latest;
+
+    size_t
+    bucket(Tick when) const
+    {
+        return (when >> shift) & (buckets.size() - 1);
+    }
+
+    void resize(size_t num_buckets);
+
+  public:
+    static constexpr size_t MinBuckets = 16;
+
+    EventCalendar();
+
+    /**
+     * Latest bin that is earlier than event, or nullptr if there is
+     * none or it cannot be found within one year of the calendar (the
+     * caller must then walk the list of bins).
+     */
+    Event *predecessor(const Event *event) const;
+
+    /** Adds the bin topped by top, which follows the bin prev. */
+    void insert(Event *top, Event *prev);
+
+    /** Removes the bin topped by top, which follows the bin prev. */
+    void remove(Event *top, Event *prev);
+
+    /** The bin topped by top is now topped by new_top. */
+    void replace(Event *top, Event *new_top);
+
+    void clear();
+
+    size_t size() const { return bins; }
+};
+
+} // namespace gem5
+
+#endif // __SIM_EVENTQ_CALENDAR_HH__
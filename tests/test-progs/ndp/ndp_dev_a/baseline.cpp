@@ -1,5 +1,9 @@
 #include "baseline.h"
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 uint64_t
 compare_n_hit(uint64_t *data, uint64_t size, uint64_t skey)
 {
@@ -32,3 +36,100 @@ compare_n_max(uint64_t *data, uint64_t size)
 
     return max;
 }
+
+template <typename T>
+uint64_t
+count_lt(T *data, uint64_t size, uint64_t skey)
+{
+    uint64_t n = 0;
+
+    for (int i = 0; i < size; ++i)
+        if (data[i] < skey)
+            n++;
+
+    return n;
+}
+
+template <typename T>
+uint64_t
+reduce_sum(T *data, uint64_t size)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < size; ++i)
+        sum += data[i];
+
+    return sum;
+}
+
+template <typename T>
+uint64_t
+reduce_min(T *data, uint64_t size)
+{
+    uint64_t min = data[0];
+    for (int i = 1; i < size; ++i)
+        if (data[i] < min)
+            min = data[i];
+
+    return min;
+}
+
+template <typename T>
+uint64_t
+reduce_avg(T *data, uint64_t size)
+{
+    return size ? reduce_sum(data, size) / size : 0;
+}
+
+template <typename T>
+uint64_t
+filter_ge(T *data, uint64_t size, uint64_t skey, T *out)
+{
+    uint64_t n = 0;
+
+    for (int i = 0; i < size; ++i)
+        if (data[i] >= skey)
+            out[n++] = data[i];
+
+    return n;
+}
+
+template <typename T>
+uint64_t
+histogram(T *data, uint64_t size, uint64_t width, uint64_t k, uint64_t *out)
+{
+    for (int i = 0; i < k; ++i)
+        out[i] = 0;
+
+    // Elements past the last bucket count in the last one
+    for (int i = 0; i < size; ++i)
+        out[std::min<uint64_t>(data[i] / width, k - 1)]++;
+
+    return size;
+}
+
+template <typename T>
+uint64_t
+top_k(T *data, uint64_t size, uint64_t k, uint64_t *out)
+{
+    std::vector<uint64_t> sorted(data, data + size);
+    uint64_t n = std::min(k, size);
+
+    std::partial_sort(sorted.begin(), sorted.begin() + n, sorted.end(), std::greater<uint64_t>());
+    std::copy(sorted.begin(), sorted.begin() + n, out);
+
+    return n;
+}
+
+#define INSTANTIATE(T) \
+    template uint64_t count_lt<T>(T *, uint64_t, uint64_t); \
+    template uint64_t reduce_sum<T>(T *, uint64_t); \
+    template uint64_t reduce_min<T>(T *, uint64_t); \
+    template uint64_t reduce_avg<T>(T *, uint64_t); \
+    template uint64_t filter_ge<T>(T *, uint64_t, uint64_t, T *); \
+    template uint64_t histogram<T>(T *, uint64_t, uint64_t, uint64_t, uint64_t *); \
+    template uint64_t top_k<T>(T *, uint64_t, uint64_t, uint64_t *);
+
+INSTANTIATE(uint8_t)
+INSTANTIATE(uint16_t)
+INSTANTIATE(uint32_t)
+INSTANTIATE(uint64_t)
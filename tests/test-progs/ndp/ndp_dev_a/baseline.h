@@ -9,4 +9,26 @@ uint64_t compare_n_count(uint64_t *data, uint64_t size, uint64_t skey);
 
 uint64_t compare_n_max(uint64_t *data, uint64_t size);
 
+// Instantiated for 8, 16, 32, and 64-bit elements in baseline.cpp
+template <typename T>
+uint64_t count_lt(T *data, uint64_t size, uint64_t skey);
+
+template <typename T>
+uint64_t reduce_sum(T *data, uint64_t size);
+
+template <typename T>
+uint64_t reduce_min(T *data, uint64_t size);
+
+template <typename T>
+uint64_t reduce_avg(T *data, uint64_t size);
+
+template <typename T>
+uint64_t filter_ge(T *data, uint64_t size, uint64_t skey, T *out);
+
+template <typename T>
+uint64_t histogram(T *data, uint64_t size, uint64_t width, uint64_t k, uint64_t *out);
+
+template <typename T>
+uint64_t top_k(T *data, uint64_t size, uint64_t k, uint64_t *out);
+
 #endif
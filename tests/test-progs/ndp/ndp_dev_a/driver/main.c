@@ -3,7 +3,12 @@
 #include <linux/module.h>     /* version info, MODULE_LICENSE, MODULE_AUTHOR, printk() */
 #include <asm/io.h>           /* address translation */
 
-extern char *ndp_dev_a_w, *ndp_dev_a_r;
+extern char *ndp_dev_a_w, *ndp_dev_a_r, *ndp_dev_a_i;
+
+/* IRQ line of the device completion interrupt, -1 polls the status register */
+static int irq = -1;
+module_param(irq, int, 0444);
+MODULE_PARM_DESC(irq, "NDPDevA completion interrupt line (-1 to poll)");
 
 MODULE_DESCRIPTION("NDPDevA Driver Template");
 MODULE_LICENSE("GPL");
@@ -17,8 +22,19 @@ static int ndp_dev_a_driver_init(void)
 
     ndp_dev_a_w = ioremap(NDP_DEV_A_AWRI, NDP_DEV_A_SWRI);
     ndp_dev_a_r = ioremap(NDP_DEV_A_AREA, NDP_DEV_A_SREA);
+    ndp_dev_a_i = ioremap(NDP_DEV_A_AINT, NDP_DEV_A_SINT);
+
+    if (irq >= 0)
+    {
+        result = ndp_dev_a_irq_init(irq);
+        if (result < 0)
+            return result;
+    }
 
     result = register_device();
+    if (result < 0 && irq >= 0)
+        ndp_dev_a_irq_exit(irq);
+
     return result;
 }
 
@@ -27,6 +43,9 @@ static void ndp_dev_a_driver_exit(void)
 {
     printk( KERN_NOTICE "NDPDevA Driver: Exiting\n" );
     unregister_device();
+
+    if (irq >= 0)
+        ndp_dev_a_irq_exit(irq);
 }
 
 /* =============================================================================================== */
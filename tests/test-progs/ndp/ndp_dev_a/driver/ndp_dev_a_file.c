@@ -5,8 +5,62 @@
 #include <linux/module.h>   /* THIS_MODULE */
 #include <linux/cdev.h>     /* char device stuff */
 #include <linux/uaccess.h>  /* copy_to_user(), copy_from_user() */
+#include <linux/interrupt.h> /* request_irq(), free_irq() */
+#include <linux/wait.h>     /* wait queues */
+#include <asm/io.h>         /* writeq(), readq() */
 
-char *ndp_dev_a_w, *ndp_dev_a_r;
+char *ndp_dev_a_w, *ndp_dev_a_r, *ndp_dev_a_i;
+
+/* Set by the completion interrupt, cleared when a new job is started */
+static DECLARE_WAIT_QUEUE_HEAD(ndp_dev_a_wait);
+static int ndp_dev_a_done = 1;
+static int ndp_dev_a_use_irq = 0;
+
+/*===============================================================================================*/
+static irqreturn_t ndp_dev_a_interrupt(int irq, void *dev_id)
+{
+    u64 __iomem *regs = (u64 __iomem *) ndp_dev_a_i;
+
+    if (!readq(&regs[NDP_DEV_A_RIST]))
+        return IRQ_NONE;
+
+    /* Acknowledge the interrupt, the device lowers the line */
+    writeq(1, &regs[NDP_DEV_A_RIST]);
+
+    ndp_dev_a_done = 1;
+    wake_up_interruptible(&ndp_dev_a_wait);
+
+    return IRQ_HANDLED;
+}
+
+/*===============================================================================================*/
+int ndp_dev_a_irq_init(int irq)
+{
+    u64 __iomem *regs = (u64 __iomem *) ndp_dev_a_i;
+    int result = request_irq(irq, ndp_dev_a_interrupt, IRQF_SHARED, "ndp_dev_a", &ndp_dev_a_wait);
+
+    if (result < 0)
+    {
+        printk( KERN_WARNING "NDPDevA Driver: cannot request irq %i with errorcode = %i\n", irq, result );
+        return result;
+    }
+
+    ndp_dev_a_use_irq = 1;
+    writeq(1, &regs[NDP_DEV_A_RIEN]);
+    printk( KERN_NOTICE "NDPDevA Driver: using completion interrupt on irq %i\n", irq );
+
+    return 0;
+}
+
+/*===============================================================================================*/
+void ndp_dev_a_irq_exit(int irq)
+{
+    u64 __iomem *regs = (u64 __iomem *) ndp_dev_a_i;
+
+    writeq(0, &regs[NDP_DEV_A_RIEN]);
+    free_irq(irq, &ndp_dev_a_wait);
+    ndp_dev_a_use_irq = 0;
+}
 
 /*===============================================================================================*/
 static ssize_t ndp_dev_a_file_write(
@@ -15,6 +69,8 @@ static ssize_t ndp_dev_a_file_write(
     , size_t count
     , loff_t *position)
 {
+    ndp_dev_a_done = 0;
+
     if (count == NDP_DEV_A_SWRI && copy_from_user(ndp_dev_a_w, user_buffer, count) == count)
         printk( KERN_NOTICE "NDPDevA Driver [W]: write %ld bytes\n", count );
     else
@@ -30,6 +86,10 @@ static ssize_t ndp_dev_a_file_read(
     , size_t count
     , loff_t *position)
 {
+    /* Sleep until the job completes instead of returning a busy status */
+    if (ndp_dev_a_use_irq && wait_event_interruptible(ndp_dev_a_wait, ndp_dev_a_done))
+        return -ERESTARTSYS;
+
     if (count == NDP_DEV_A_SREA && copy_to_user(user_buffer, ndp_dev_a_r, count) == count)
         printk( KERN_NOTICE "NDPDevA Driver [R]: read %ld bytes\n", count );
     else
@@ -6,6 +6,9 @@
 __must_check int register_device(void); /* 0 if ok*/
 void unregister_device(void);
 
+int ndp_dev_a_irq_init(int irq);       /* 0 if ok */
+void ndp_dev_a_irq_exit(int irq);
+
 #define NDP_DEV_A_CADR 0x40000000
 #define NDP_DEV_A_CSZE 0x1000
 
@@ -15,4 +18,10 @@ void unregister_device(void);
 #define NDP_DEV_A_AREA (NDP_DEV_A_CADR + NDP_DEV_A_SWRI)
 #define NDP_DEV_A_SREA 0x10				// 2 8-byte registers to read
 
+#define NDP_DEV_A_AINT (NDP_DEV_A_CADR + NDP_DEV_A_CSZE - NDP_DEV_A_SINT)
+#define NDP_DEV_A_SINT 0x10				// interrupt enable and status registers
+
+#define NDP_DEV_A_RIEN 0				// interrupt enable register
+#define NDP_DEV_A_RIST 1				// interrupt status register (write to ack)
+
 #endif // _DEVICE_FILE_H_
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <cstdint>
 #include <chrono>
+#include <cstring>
 
 #ifdef FS
 #include <cassert>
@@ -24,6 +25,26 @@
 
 #define START_CODE 50
 
+// Command code: op in bits 7:0, element width in 9:8, predicate in 14:12,
+// and the bucket count or k in 31:16
+#define CMD(op, width, pred, param) ((op) | (width) << 8 | (pred) << 12 | (uint64_t) (param) << 16)
+#define OP_COUNT 1
+#define OP_SUM 3
+#define OP_MIN 4
+#define OP_AVG 5
+#define OP_FILTER 6
+#define OP_HISTOGRAM 7
+#define OP_TOPK 8
+#define WIDTH_64 0
+#define WIDTH_8 1
+#define WIDTH_16 2
+#define WIDTH_32 3
+#define PRED_LT 2
+#define PRED_GE 5
+
+#define NUM_BUCKETS 16
+#define TOP_K 8
+
 #define DATA_SIZE 0x10000
 #define MAX_KEY (DATA_SIZE / 4)
 
@@ -56,12 +77,18 @@ main(int argc, char *argv[])
     uint64_t *ndp_ctrl = ndp_mreg;
 #endif
     
+    uint64_t *ndp_regs = ndp_mreg;
     uint64_t *ndp_data = ndp_mreg + (NDP_CSZE / sizeof(uint64_t));
 #else
     uint64_t *ndp_ctrl = (uint64_t *) NDP_CTRL;
+    uint64_t *ndp_regs = ndp_ctrl;
     uint64_t *ndp_data = (uint64_t *) NDP_DATA;
 #endif
 
+    // Jobs that produce arrays write them right after the data
+    uint64_t *ndp_outp = ndp_data + DATA_SIZE;
+    static uint64_t sw_outp[DATA_SIZE];
+
     // Initialize data
     for (int i = 0; i < DATA_SIZE; ++i)
     {
@@ -81,6 +108,31 @@ main(int argc, char *argv[])
     uint64_t &pi_strt_rgst = ndp_ctrl[4];
     uint64_t &pi_stat_rgst = ndp_ctrl[5];
     uint64_t &pi_last_rslt = ndp_ctrl[6];
+    // Not part of the driver's register window, always written directly
+    uint64_t &pi_addr_outp = ndp_regs[11];
+
+    // Runs one job on the whole data array and returns its result
+    auto run_hw = [&](uint64_t skey, uint64_t cmmd)
+    {
+        pi_addr_data = NDP_DATA;
+        pi_data_size = DATA_SIZE;
+        pi_data_skey = skey;
+        pi_cmmd_code = cmmd;
+        pi_strt_rgst = START_CODE;
+#if defined(FS) && defined(DRIVER)
+        assert(write(fd_ndp_dev_a, (void *) ndp_ctrl, WRI_SIZE) == WRI_SIZE);
+        do
+        {
+            assert(read(fd_ndp_dev_a, (void *) (ndp_ctrl + WRI_SIZE  / sizeof(uint64_t)), REA_SIZE) == REA_SIZE);
+        }
+        while (!pi_stat_rgst);
+#else
+        while (!pi_stat_rgst);
+#endif
+        return pi_last_rslt;
+    };
+
+    pi_addr_outp = NDP_DATA + DATA_SIZE * sizeof(uint64_t);
 
     std::cout << "========== WORKLOAD STARTED ========" << std::endl;
 
@@ -253,5 +305,165 @@ main(int argc, char *argv[])
         1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
     );
 
+    /* ================================= Sum_TSC ================================ */
+    start_sw = GET_TICKS;
+    res_sw = reduce_sum(ndp_data, DATA_SIZE);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(0, CMD(OP_SUM, WIDTH_64, 0, 0));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] Sum_TSC:       sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
+    /* ================================= Min_TSC ================================ */
+    start_sw = GET_TICKS;
+    res_sw = reduce_min(ndp_data, DATA_SIZE);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(0, CMD(OP_MIN, WIDTH_64, 0, 0));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] Min_TSC:       sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
+    /* ================================= Avg_TSC ================================ */
+    start_sw = GET_TICKS;
+    res_sw = reduce_avg(ndp_data, DATA_SIZE);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(0, CMD(OP_AVG, WIDTH_64, 0, 0));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] Avg_TSC:       sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
+    /* =============================== Filter_TSC =============================== */
+    start_sw = GET_TICKS;
+    res_sw = filter_ge(ndp_data, DATA_SIZE, MAX_KEY / 2, sw_outp);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(MAX_KEY / 2, CMD(OP_FILTER, WIDTH_64, PRED_GE, 0));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] Filter_TSC:    sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw &&
+            !memcmp(sw_outp, ndp_outp, res_sw * sizeof(uint64_t)) ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
+    /* ============================== Histogram_TSC ============================= */
+    start_sw = GET_TICKS;
+    res_sw = histogram(ndp_data, DATA_SIZE, MAX_KEY / NUM_BUCKETS, NUM_BUCKETS, sw_outp);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(MAX_KEY / NUM_BUCKETS, CMD(OP_HISTOGRAM, WIDTH_64, 0, NUM_BUCKETS));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] Histogram_TSC: sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw &&
+            !memcmp(sw_outp, ndp_outp, NUM_BUCKETS * sizeof(uint64_t)) ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
+    /* ================================ TopK_TSC ================================ */
+    start_sw = GET_TICKS;
+    res_sw = top_k(ndp_data, DATA_SIZE, TOP_K, sw_outp);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(0, CMD(OP_TOPK, WIDTH_64, 0, TOP_K));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] TopK_TSC:      sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw &&
+            !memcmp(sw_outp, ndp_outp, TOP_K * sizeof(uint64_t)) ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
+    // The narrow widths view the first DATA_SIZE elements of the same
+    // array. The keys do not fit in the elements, so they must be compared
+    // at full width: every byte is below 0x100 and no 32-bit element is
+    // at or above 2^32.
+    /* ================================ Count_W8 ================================ */
+    start_sw = GET_TICKS;
+    res_sw = count_lt((uint8_t *) ndp_data, DATA_SIZE, 0x100);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(0x100, CMD(OP_COUNT, WIDTH_8, PRED_LT, 0));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] Count_W8:      sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
+    /* ================================= Sum_W16 ================================ */
+    start_sw = GET_TICKS;
+    res_sw = reduce_sum((uint16_t *) ndp_data, DATA_SIZE);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(0, CMD(OP_SUM, WIDTH_16, 0, 0));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] Sum_W16:       sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
+    /* =============================== Filter_W32 =============================== */
+    start_sw = GET_TICKS;
+    res_sw = filter_ge((uint32_t *) ndp_data, DATA_SIZE, 1ull << 32, (uint32_t *) sw_outp);
+    end_sw = GET_TICKS;
+
+    start_hw = GET_TICKS;
+    res_hw = run_hw(1ull << 32, CMD(OP_FILTER, WIDTH_32, PRED_GE, 0));
+    end_hw = GET_TICKS;
+
+    printf(
+        "[%s] Filter_W32:    sw: %6lu ns, hw: %6lu ns (norm: %2.3f)\n",
+        res_sw == res_hw ? "PASS" : "FAIL",
+        GET_ELAPS(start_sw, end_sw),
+        GET_ELAPS(start_hw, end_hw),
+        1.0 * GET_ELAPS(start_hw, end_hw) / GET_ELAPS(start_sw, end_sw)
+    );
+
     return 0;
 }
@@ -0,0 +1,93 @@
+/*
+ * Example kernels for NDPDevProg, loaded with
+ *     NDPDevProg(kernels=["tests/test-progs/ndp/ndp_dev_prog/kernels.so"])
+ * Command 0 counts the elements equal to the argument, command 1 adds
+ * all the elements and command 2 copies the elements greater than the
+ * argument to the output address.
+ */
+
+#include "ndp_kernel.h"
+
+static uint64_t
+count_step(struct ndp_kernel_job *job, const void *in, uint64_t elems,
+	void *out, uint64_t *out_elems, int *stop)
+{
+	const uint64_t *data = (const uint64_t *) in;
+
+	for (uint64_t i = 0; i < elems; i++)
+		job->result += data[i] == job->arg;
+
+	return elems;
+}
+
+static uint64_t
+sum_step(struct ndp_kernel_job *job, const void *in, uint64_t elems,
+	void *out, uint64_t *out_elems, int *stop)
+{
+	const uint64_t *data = (const uint64_t *) in;
+
+	for (uint64_t i = 0; i < elems; i++)
+		job->result += data[i];
+
+	return elems;
+}
+
+static uint64_t
+filter_step(struct ndp_kernel_job *job, const void *in, uint64_t elems,
+	void *out, uint64_t *out_elems, int *stop)
+{
+	const uint64_t *data = (const uint64_t *) in;
+	uint64_t *kept = (uint64_t *) out;
+
+	for (uint64_t i = 0; i < elems; i++)
+	{
+		if (data[i] > job->arg)
+			kept[(*out_elems)++] = data[i];
+	}
+
+	/* The number of kept elements is the result of the job */
+	job->result += *out_elems;
+
+	return elems;
+}
+
+static const struct ndp_kernel table[] = {
+	{
+		.abi = NDP_KERNEL_ABI,
+		.name = "count",
+		.in_elem_size = sizeof(uint64_t),
+		.tile_elems = 512,
+		.lanes = 4,
+		.tile_cycles = 2,
+		.elem_cycles = 1,
+		.step = count_step,
+	},
+	{
+		.abi = NDP_KERNEL_ABI,
+		.name = "sum",
+		.in_elem_size = sizeof(uint64_t),
+		.tile_elems = 512,
+		.lanes = 4,
+		.tile_cycles = 2,
+		.elem_cycles = 1,
+		.step = sum_step,
+	},
+	{
+		.abi = NDP_KERNEL_ABI,
+		.name = "filter",
+		.in_elem_size = sizeof(uint64_t),
+		.out_elem_size = sizeof(uint64_t),
+		.tile_elems = 512,
+		.lanes = 2,
+		.tile_cycles = 4,
+		.elem_cycles = 1,
+		.step = filter_step,
+	},
+};
+
+const struct ndp_kernel *
+ndp_kernels(uint32_t *count)
+{
+	*count = sizeof(table) / sizeof(table[0]);
+	return table;
+}
@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NDP_CTRL 0x40000000
+#define NDP_DATA 0x40001000
+
+#define DATA_SIZE 0x4000
+#define MAX_KEY (DATA_SIZE / 4)
+
+// Kernels of kernels.so in command code order
+enum { cmd_count, cmd_sum, cmd_filter };
+
+static volatile uint64_t *ndp_ctrl = (uint64_t *) NDP_CTRL;
+
+static uint64_t
+run(uint64_t cmd, uint64_t *data, uint64_t size, uint64_t *out, uint64_t arg)
+{
+    ndp_ctrl[0] = (uint64_t) data;
+    ndp_ctrl[1] = size;
+    ndp_ctrl[2] = (uint64_t) out;
+    ndp_ctrl[3] = arg;
+    ndp_ctrl[4] = cmd;
+
+    while (!ndp_ctrl[5]);
+
+    return ndp_ctrl[6];
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint64_t *data = (uint64_t *) NDP_DATA;
+    uint64_t *out = data + DATA_SIZE;
+    uint64_t count = 0, sum = 0, kept = 0;
+
+    for (int i = 0; i < DATA_SIZE; ++i)
+    {
+        data[i] = rand() % MAX_KEY;
+        count += data[i] == 7;
+        sum += data[i];
+        kept += data[i] > MAX_KEY / 2;
+    }
+
+    printf("Kernels loaded: %lu\n", ndp_ctrl[8]);
+
+    printf("[%s] count\n", run(cmd_count, data, DATA_SIZE, 0, 7) == count ? "PASS" : "FAIL");
+    printf("[%s] sum\n", run(cmd_sum, data, DATA_SIZE, 0, 0) == sum ? "PASS" : "FAIL");
+    printf(
+        "[%s] filter\n",
+        run(cmd_filter, data, DATA_SIZE, out, MAX_KEY / 2) == kept &&
+        ndp_ctrl[7] == kept && out[kept - 1] > MAX_KEY / 2 ? "PASS" : "FAIL"
+    );
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#define NDP_CTRL 0x40000000
+#define NDP_DATA 0x40001000
+
+#define ELEMS 512
+#define RUNS 8
+
+// NDPDevA PI registers
+enum { pi_addr_data, pi_data_size, pi_data_skey, pi_cmmd_code, pi_start, pi_stat_rgst, pi_last_rslt };
+
+enum { cmd_count = 1 };
+
+static volatile uint64_t *ndp_ctrl = (uint64_t *) NDP_CTRL;
+
+static inline uint64_t
+rdcycle(void)
+{
+    uint64_t cycles;
+    asm volatile ("rdcycle %0" : "=r" (cycles));
+    return cycles;
+}
+
+// Writes r0-r4 with a single 40-byte store (custom-0, funct3 3), the
+// descriptor goes in x[rs2] to x[rs2+4], a0 to a4 here
+static inline void
+ndp_submit(uint64_t addr, uint64_t size, uint64_t skey, uint64_t cmmd, uint64_t scale)
+{
+    register uint64_t a0 asm("a0") = addr;
+    register uint64_t a1 asm("a1") = size;
+    register uint64_t a2 asm("a2") = skey;
+    register uint64_t a3 asm("a3") = cmmd;
+    register uint64_t a4 asm("a4") = scale;
+
+    asm volatile (
+        ".insn s 0x0b, 3, a0, 0(%0)"
+        :
+        : "r" (ndp_ctrl), "r" (a0), "r" (a1), "r" (a2), "r" (a3), "r" (a4)
+        : "memory"
+    );
+}
+
+// Reads r5 and r6 (offset 40, only aligned to 8 bytes) into x[rd] and
+// x[rd+1] with a single 16-byte load (custom-1, funct3 3), a0 and a1 here
+static inline uint64_t
+ndp_poll(uint64_t *result)
+{
+    register uint64_t a0 asm("a0");
+    register uint64_t a1 asm("a1");
+
+    asm volatile (
+        ".insn i 0x2b, 3, a0, 40(%2)"
+        : "=r" (a0), "=r" (a1)
+        : "r" (ndp_ctrl)
+        : "memory"
+    );
+
+    *result = a1;
+    return a0;
+}
+
+static uint64_t
+count_insn(uint64_t *data, uint64_t key, uint64_t *cycles)
+{
+    uint64_t result, start = rdcycle();
+
+    ndp_submit((uint64_t) data, ELEMS, key, cmd_count, 1);
+    while (!ndp_poll(&result));
+
+    *cycles += rdcycle() - start;
+    return result;
+}
+
+static uint64_t
+count_pi(uint64_t *data, uint64_t key, uint64_t *cycles)
+{
+    uint64_t start = rdcycle();
+
+    ndp_ctrl[pi_addr_data] = (uint64_t) data;
+    ndp_ctrl[pi_data_size] = ELEMS;
+    ndp_ctrl[pi_data_skey] = key;
+    ndp_ctrl[pi_cmmd_code] = cmd_count;
+    ndp_ctrl[pi_start] = 1;
+    while (!ndp_ctrl[pi_stat_rgst]);
+
+    uint64_t result = ndp_ctrl[pi_last_rslt];
+
+    *cycles += rdcycle() - start;
+    return result;
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint64_t *data = (uint64_t *) NDP_DATA;
+    uint64_t insn_cycles = 0, pi_cycles = 0;
+    int passed = 1;
+
+    for (int i = 0; i < ELEMS; ++i)
+        data[i] = i % 7;
+
+    for (uint64_t key = 0; key < RUNS; ++key)
+    {
+        uint64_t expected = 0;
+        for (int i = 0; i < ELEMS; ++i)
+            expected += data[i] == key;
+
+        uint64_t insn = count_insn(data, key, &insn_cycles);
+        uint64_t pi = count_pi(data, key, &pi_cycles);
+
+        if (insn != expected || pi != expected)
+        {
+            printf("key %lu: expected %lu, ndp_submit %lu, PI %lu\n", key, expected, insn, pi);
+            passed = 0;
+        }
+    }
+
+    printf("[%s] ndp_submit/ndp_poll match the PI registers\n", passed ? "PASS" : "FAIL");
+    printf("ndp_submit/ndp_poll: %lu cycles per job\n", insn_cycles / RUNS);
+    printf("PI registers: %lu cycles per job\n", pi_cycles / RUNS);
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#define NDP_CTRL 0x40000000
+#define NDP_DATA 0x40001000
+#define NDP_CSZE 0x1000
+
+// Registers reserved by every NDP device, counted from the end of the PI
+#define PI_REGS (NDP_CSZE / sizeof(uint64_t))
+#define PI_CMO_ADDR (PI_REGS - 6)
+#define PI_CMO_SIZE (PI_REGS - 5)
+#define PI_CMO_CMMD (PI_REGS - 4)
+
+enum { cmo_clean = 1, cmo_clean_inv = 2 };
+
+static volatile uint64_t *ndp_ctrl = (uint64_t *) NDP_CTRL;
+
+// Runs a cache maintenance command and waits for it to complete
+static int
+maintain(uint64_t addr, uint64_t size, uint64_t cmd)
+{
+    ndp_ctrl[PI_CMO_ADDR] = addr;
+    ndp_ctrl[PI_CMO_SIZE] = size;
+    ndp_ctrl[PI_CMO_CMMD] = cmd;
+
+    while (!ndp_ctrl[PI_CMO_CMMD]);
+
+    return ndp_ctrl[PI_CMO_ADDR] == addr && ndp_ctrl[PI_CMO_SIZE] == size;
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint64_t data = NDP_DATA;
+
+    for (int i = 0; i < 256; ++i)
+        ((volatile uint8_t *) data)[i] = i;
+
+    // Empty commands touch no line, not even the one addr falls in
+    printf("[%s] clean 0 bytes unaligned\n", maintain(data + 3, 0, cmo_clean) ? "PASS" : "FAIL");
+    printf("[%s] clean+inv 0 bytes unaligned\n", maintain(data + 61, 0, cmo_clean_inv) ? "PASS" : "FAIL");
+
+    // The device must still be usable afterwards
+    printf("[%s] clean 100 bytes unaligned\n", maintain(data + 3, 100, cmo_clean) ? "PASS" : "FAIL");
+    printf("[%s] clean+inv 1 byte unaligned\n", maintain(data + 127, 1, cmo_clean_inv) ? "PASS" : "FAIL");
+
+    printf(
+        "[%s] data kept\n",
+        ((volatile uint8_t *) data)[3] == 3 && ((volatile uint8_t *) data)[127] == 127 ? "PASS" : "FAIL"
+    );
+
+    return 0;
+}